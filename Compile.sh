@@ -9,6 +9,7 @@ if [[ -z $OPENCV_COMPILER_ARGS ]]; then
 	read -n 1 -s
 	exit 1
 fi
-g++ -O3 Projects/Evaluation/Evaluation.cpp -I./Libraries/JSON -lstdc++fs $OPENCV_COMPILER_ARGS -o x64/Release/Evaluation
+g++ -O3 -pthread Projects/Evaluation/Evaluation.cpp -I./Libraries/JSON -lstdc++fs -ldl -lrt $OPENCV_COMPILER_ARGS -o x64/Release/Evaluation
 g++ -O3 Projects/Example-C++/Example.cpp -lstdc++fs $OPENCV_COMPILER_ARGS -o x64/Release/Example
-g++ -O3 Projects/Template-C++/Template.cpp $OPENCV_COMPILER_ARGS -o x64/Release/Template
+g++ -O3 -pthread Projects/Template-C++/Template.cpp $OPENCV_COMPILER_ARGS -lrt -o x64/Release/Template
+g++ -O3 -pthread -shared -fPIC -DDICE_DETECTION_PLUGIN Projects/Template-C++/Template.cpp $OPENCV_COMPILER_ARGS -lrt -o x64/Release/Template.so
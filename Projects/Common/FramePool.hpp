@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// OpenCV 4 replaced the int access flags of cv::MatAllocator by an enum.
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag MatAccessFlags;
+#else
+typedef int MatAccessFlags;
+#endif
+
+// Recycles the data buffers of cv::Mats: a cv::Mat attached to the pool takes a free buffer of the right size when it is created and gives it back when its last reference is released, instead of allocating and freeing megabytes per frame.
+// Loops that process frames of one size therefore stop allocating after the first frames. Buffers still in use when the pool is destroyed are reported as leaks and not freed, so the pool has to outlive every cv::Mat attached to it.
+class FramePool : public cv::MatAllocator
+{
+public:
+	struct Statistics
+	{
+		// Buffers allocated from the heap, i.e. requests that no free buffer could serve.
+		size_t numAllocations;
+		// Requests served by a free buffer.
+		size_t numReuses;
+		size_t numBuffersInUse;
+		// Maximum number of buffers in use at the same time.
+		size_t highWaterMark;
+	};
+
+	// At most maxFreeBuffers released buffers are kept for reuse, further ones are freed.
+	explicit FramePool(const std::string& name, size_t maxFreeBuffers = 16)
+		: name(name), maxFreeBuffers(maxFreeBuffers)
+	{
+	}
+
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	~FramePool()
+	{
+		if (statistics.numBuffersInUse != 0)
+			std::cerr << "Frame pool \"" << name << "\": " << statistics.numBuffersInUse << " buffer(s) leaked!" << std::endl;
+		for (cv::UMatData* p_buffer : freeBuffers)
+		{
+			cv::fastFree(p_buffer->origdata);
+			delete p_buffer;
+		}
+	}
+
+	// The image takes its data from the pool from its next (re)allocation on, e.g. "cv::Mat3b frame; framePool.attach(frame); videoCapture >> frame;". Assigning another cv::Mat to the image detaches it again.
+	void attach(cv::Mat& image)
+	{
+		image.allocator = this;
+	}
+
+	Statistics getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return statistics;
+	}
+
+	void printStatistics(std::ostream& stream) const
+	{
+		Statistics currentStatistics = getStatistics();
+		stream << "Frame pool \"" << name << "\": " << currentStatistics.numAllocations << " buffer(s) allocated, " << currentStatistics.numReuses << " reused, at most " << currentStatistics.highWaterMark << " in use at once, " << currentStatistics.numBuffersInUse << " still in use." << std::endl;
+	}
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* p_data, size_t* steps, MatAccessFlags flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		// Matrices on user-provided memory have nothing to recycle.
+		if (p_data != nullptr)
+			return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, p_data, steps, flags, usageFlags);
+
+		// Continuous layout, like OpenCV's standard allocator.
+		size_t numBytes = CV_ELEM_SIZE(type);
+		for (int i = dims - 1; i >= 0; --i)
+		{
+			if (steps != nullptr)
+				steps[i] = numBytes;
+			numBytes *= sizes[i];
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		cv::UMatData* p_buffer = nullptr;
+		auto it = std::find_if(freeBuffers.begin(), freeBuffers.end(), [&](const cv::UMatData* p_freeBuffer) { return p_freeBuffer->size == numBytes; });
+		if (it != freeBuffers.end())
+		{
+			p_buffer = *it;
+			*it = freeBuffers.back();
+			freeBuffers.pop_back();
+			++statistics.numReuses;
+		}
+		else
+		{
+			p_buffer = new cv::UMatData(this);
+			p_buffer->data = p_buffer->origdata = static_cast<uchar*>(cv::fastMalloc(numBytes));
+			p_buffer->size = numBytes;
+			++statistics.numAllocations;
+		}
+		statistics.highWaterMark = std::max(statistics.highWaterMark, ++statistics.numBuffersInUse);
+		return p_buffer;
+	}
+
+	bool allocate(cv::UMatData* p_buffer, MatAccessFlags, cv::UMatUsageFlags) const override
+	{
+		return p_buffer != nullptr;
+	}
+
+	// Called by OpenCV once the last cv::Mat referencing the buffer is released.
+	void deallocate(cv::UMatData* p_buffer) const override
+	{
+		if (p_buffer == nullptr)
+			return;
+		CV_Assert(p_buffer->refcount == 0 && p_buffer->urefcount == 0);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		--statistics.numBuffersInUse;
+		if (freeBuffers.size() < maxFreeBuffers)
+		{
+			freeBuffers.push_back(p_buffer);
+			return;
+		}
+		cv::fastFree(p_buffer->origdata);
+		delete p_buffer;
+	}
+
+private:
+	const std::string name;
+	const size_t maxFreeBuffers;
+	// cv::MatAllocator's interface is const, the pool's state is not.
+	mutable std::mutex mutex;
+	mutable std::vector<cv::UMatData*> freeBuffers;
+	mutable Statistics statistics = {};
+};
+
+// Counts the cv::Mat data allocations made through it and forwards everything to OpenCV's standard allocator. Installed with cv::Mat::setDefaultAllocator, it shows whether a loop allocates frame buffers once it has reached its steady state (other heap allocations, e.g. through operator new, are not counted), e.g.:
+//   CountingMatAllocator allocator; cv::MatAllocator* p_previousAllocator = cv::Mat::getDefaultAllocator(); cv::Mat::setDefaultAllocator(&allocator); ... allocator.getNumAllocations() ...; cv::Mat::setDefaultAllocator(p_previousAllocator);
+// Matrices allocated through it are released by the standard allocator, so it may be uninstalled and destroyed while they are still alive.
+class CountingMatAllocator : public cv::MatAllocator
+{
+public:
+	size_t getNumAllocations() const
+	{
+		return numAllocations;
+	}
+
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* p_data, size_t* steps, MatAccessFlags flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		if (p_data == nullptr)
+			++numAllocations;
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, p_data, steps, flags, usageFlags);
+	}
+
+	bool allocate(cv::UMatData* p_buffer, MatAccessFlags flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(p_buffer, flags, usageFlags);
+	}
+
+	void deallocate(cv::UMatData* p_buffer) const override
+	{
+		cv::Mat::getStdAllocator()->deallocate(p_buffer);
+	}
+
+private:
+	mutable std::atomic<size_t> numAllocations{ 0 };
+};
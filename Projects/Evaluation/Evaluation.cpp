@@ -1,13 +1,43 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <experimental/filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <opencv2/opencv.hpp>
 #include <json.hpp>
+#include "../Common/FramePool.hpp"
 #if _WIN32
 #include <Windows.h>
+#include <Psapi.h>
 #elif __unix__
+#include <csignal>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #else
 #error Unknown platform!
 #endif
@@ -24,12 +54,20 @@ struct DetectionResult
 {
 	uint referenceFrameNo;
 	std::vector<DetectedDie> detectedDice;
+
+	// Optionally reported by the competitor (in its order of reporting).
+	std::vector<std::pair<std::string, double>> stageTimesMs;
+	std::vector<std::pair<std::string, int64_t>> counters;
 };
 
 struct GroundtruthDie
 {
 	std::vector<cv::Point> contourPoints;
 	uint value;
+
+	// Precomputed from the contour.
+	cv::Rect boundingBox;
+	cv::Point2d centroid;
 };
 
 struct Groundtruth
@@ -38,10 +76,18 @@ struct Groundtruth
 	std::vector<GroundtruthDie> groundtruthDice;
 };
 
+// Bump this whenever the scoring rules change, it invalidates the result cache.
+const uint SCORING_VERSION = 1;
+
+class CompetitorPlugin;
+class PersistentCompetitorProcess;
+
 struct Competitor
 {
 	std::string name;
 	std::string executablePath;
+	uint64_t executableHash = 0;
+	std::shared_ptr<CompetitorPlugin> p_plugin;
 	bool currentVideoDone = false;
 	int currentVideoScore = 0;
 	int totalScore = 0;
@@ -49,6 +95,125 @@ struct Competitor
 	uint currentRank = 0;
 };
 
+struct EvaluationOptions
+{
+	// Skip all windows, the video preview and all fixed delays (for batch runs on machines without a display).
+	bool headless = false;
+
+	// Number of competitor runs executed concurrently (0 = one per hardware thread).
+	uint numWorkers = 1;
+
+	// Pin each worker (and thus the competitors it launches) to its own CPU core.
+	bool pinWorkers = false;
+
+	// Benchmark mode: number of measured runs per (video, competitor) pair (0 = single run, no benchmark output).
+	uint numBenchmarkRuns = 0;
+
+	// Benchmark mode: number of additional runs before the measured ones whose timings are discarded.
+	uint numWarmupRuns = 0;
+
+	// Benchmark mode: evict the video file from the OS page cache before every run.
+	bool coldCache = false;
+
+	// Capacity (in frames) of the decoded-frame cache of each evaluation video.
+	uint frameCacheCapacity = 16;
+
+	// Score every result with both the rasterized and the polygon-test scoring and report any difference.
+	bool scoreSelfCheck = false;
+
+	// Re-score the result files of an existing results directory instead of running the competitors.
+	bool rescore = false;
+
+	// Re-scoring: also regenerate the overlay images.
+	bool rescoreOverlays = false;
+
+	// Compiled groundtruth store to use instead of parsing the JSON files (empty = none).
+	std::string groundtruthStoreFilename;
+
+	// Compile the groundtruth of the evaluation data directory into a groundtruth store and exit.
+	bool compileGroundtruth = false;
+
+	// Directory of the persistent result cache (empty = no caching).
+	std::string resultCacheDirectory;
+
+	// Run shared-library competitors in a child process (the evaluation re-executed as plugin host) instead of in-process (Linux only).
+	bool isolatePlugins = false;
+
+	// Memory budget (in MiB) per video for decoding it once into shared memory for all competitors that read through "SharedFrameSource.hpp" (0 = off, Unix only).
+	uint sharedFramesBudgetMb = 0;
+
+	// Number of background threads that render and write the overlay images.
+	uint numOverlayWriters = 2;
+
+	// Scale factor of the written overlay images (< 1 = reduced resolution).
+	double overlayScale = 1;
+
+	// Write the overlay images as JPEG into a single "Overlays.tar" per run instead of one PNG file each.
+	bool overlayArchive = false;
+
+	// Resource policy of each competitor run: number of CPU cores (0 = unlimited), enforced by affinity (and the cgroup's CPU quota).
+	uint cpuLimit = 0;
+
+	// Resource policy: memory limit in MiB (0 = unlimited), enforced by the cgroup or else as address-space limit (Unix only).
+	uint memoryLimitMb = 0;
+
+	// Resource policy: maximum number of threads (0 = unlimited), only enforced by a cgroup.
+	uint threadLimit = 0;
+
+	// Delegated cgroup v2 directory in which each competitor run gets its own cgroup (empty = no cgroups, Unix only).
+	std::string cgroupDirectory;
+
+	// Start the competitor executables in worker mode ("--worker") and pass each one several videos one by one, instead of starting it for every video (Unix only, see PersistentCompetitorProcess and CompetitorScheduler).
+	bool persistentCompetitors = false;
+
+	// Print additional diagnostics, e.g. the frame pool statistics of the overlay writer.
+	bool verbose = false;
+};
+
+struct LatencySummary
+{
+	uint minMs = 0;
+	uint medianMs = 0;
+	uint p95Ms = 0;
+	uint maxMs = 0;
+};
+
+// Stage times and counters reported by one competitor, summed up over all videos.
+struct StageBreakdown
+{
+	uint numVideos = 0;
+	uint64_t wallTimeMs = 0;
+	std::vector<std::pair<std::string, double>> stageTimesMs;
+	std::vector<std::pair<std::string, int64_t>> counters;
+};
+
+struct RunStatistics
+{
+	uint wallTimeMs = 0;
+	uint userTimeMs = 0;
+	uint systemTimeMs = 0;
+	size_t peakRssKb = 0;
+	int exitCode = 0;
+	int terminationSignal = 0;
+	bool timedOut = false;
+};
+
+struct CompetitorRun
+{
+	bool gotResult = false;
+	DetectionResult detectionResult;
+	RunStatistics statistics;
+
+	// Wall times of the successful measured runs (benchmark mode only).
+	std::vector<uint> latenciesMs;
+
+	// Measured runs that failed, crashed or timed out (benchmark mode only). Their wall times are not latencies of the detection.
+	uint numFailedRuns = 0;
+
+	// Taken from the result cache instead of running the competitor.
+	bool fromCache = false;
+};
+
 template <typename T> T fromString(const std::string& string)
 {
 	std::istringstream stream(string);
@@ -65,26 +230,77 @@ void putTextShadow(cv::InputOutputArray img, const cv::String& text, cv::Point o
 	cv::putText(img, text, org, fontFace, fontScale, color, thickness, lineType, bottomLeftOrigin);
 }
 
-DetectionResult loadDetectionResult(const std::string& filename)
+bool readDetectionResult(std::istream& stream, DetectionResult& outDetectionResult)
 {
 	DetectionResult detectionResult;
-	std::ifstream file(filename);
-	file >> detectionResult.referenceFrameNo;
+	stream >> detectionResult.referenceFrameNo;
 	size_t numDice;
-	file >> numDice;
-	for (size_t i = 0; i < numDice; ++i)
+	stream >> numDice;
+	for (size_t i = 0; i < numDice && stream; ++i)
 	{
 		DetectedDie detectedDie;
-		file >> detectedDie.somePositionWithin.x >> detectedDie.somePositionWithin.y >> detectedDie.value;
+		stream >> detectedDie.somePositionWithin.x >> detectedDie.somePositionWithin.y >> detectedDie.value;
 		detectionResult.detectedDice.push_back(detectedDie);
 	}
 
-	if (!file)
+	if (!stream)
+		return false;
+
+	// Optional extension after the dice: "stage <name> <milliseconds>" and "counter <name> <value>" lines. Unknown and malformed lines are ignored, so older and newer competitors stay compatible.
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		std::istringstream lineStream(line);
+		std::string keyword, name;
+		lineStream >> keyword >> name;
+		double milliseconds;
+		int64_t value;
+		if (keyword == "stage" && lineStream >> milliseconds)
+			detectionResult.stageTimesMs.emplace_back(name, milliseconds);
+		else if (keyword == "counter" && lineStream >> value)
+			detectionResult.counters.emplace_back(name, value);
+	}
+
+	outDetectionResult = detectionResult;
+	return true;
+}
+
+// Same format as written by the competitors.
+void writeDetectionResult(std::ostream& stream, const DetectionResult& detectionResult)
+{
+	stream << detectionResult.referenceFrameNo << std::endl;
+	stream << detectionResult.detectedDice.size() << std::endl;
+	for (const DetectedDie& detectedDie : detectionResult.detectedDice)
+		stream << detectedDie.somePositionWithin.x << ' ' << detectedDie.somePositionWithin.y << ' ' << detectedDie.value << std::endl;
+	for (const auto& stageTime : detectionResult.stageTimesMs)
+		stream << "stage " << stageTime.first << ' ' << stageTime.second << std::endl;
+	for (const auto& counter : detectionResult.counters)
+		stream << "counter " << counter.first << ' ' << counter.second << std::endl;
+}
+
+DetectionResult loadDetectionResult(const std::string& filename)
+{
+	DetectionResult detectionResult;
+	std::ifstream file(filename);
+	if (!readDetectionResult(file, detectionResult))
 		throw std::runtime_error("Failed to open/read/parse detection result file \"" + filename + "\"!");
 
 	return detectionResult;
 }
 
+std::string getDetectionResultFilename(const std::string& resultsDirectory, const std::string& videoBasename, const std::string& competitorName)
+{
+	return resultsDirectory + '/' + fs::path(videoBasename).filename().string() + " - " + competitorName + ".txt";
+}
+
+// A degenerate contour (no area) has its centroid at the center of its bounding box.
+cv::Point2d getCentroid(const cv::Moments& contourMoments, const cv::Rect& boundingBox)
+{
+	if (contourMoments.m00 == 0)
+		return cv::Point2d(boundingBox.x + 0.5 * boundingBox.width, boundingBox.y + 0.5 * boundingBox.height);
+	return cv::Point2d(contourMoments.m10 / contourMoments.m00, contourMoments.m01 / contourMoments.m00);
+}
+
 Groundtruth loadGroundtruth(const std::string& filename)
 {
 	std::ifstream file(filename);
@@ -108,6 +324,8 @@ Groundtruth loadGroundtruth(const std::string& filename)
 				throw std::runtime_error("Invalid die value: " + std::to_string(groundtruthDie.value));
 			for (const auto& point : shape["points"])
 				groundtruthDie.contourPoints.emplace_back(point[0], point[1]);
+			groundtruthDie.boundingBox = cv::boundingRect(groundtruthDie.contourPoints);
+			groundtruthDie.centroid = getCentroid(cv::moments(groundtruthDie.contourPoints), groundtruthDie.boundingBox);
 			groundtruth.groundtruthDice.push_back(groundtruthDie);
 		}
 
@@ -119,169 +337,2782 @@ Groundtruth loadGroundtruth(const std::string& filename)
 	}
 }
 
-bool callCompetitor(const Competitor& competitor, const std::string& videoBasename, const std::string& resultsDirectory, uint timeoutMs, DetectionResult& outDetectionResult, uint& outRunningTime)
+std::string describeExitStatus(const RunStatistics& statistics)
 {
-	std::string detectionResultFilename = resultsDirectory + '/' + fs::path(videoBasename).filename().string() + " - " + competitor.name + ".txt";
-	
-	if (fs::is_regular_file(detectionResultFilename))
-		fs::remove(detectionResultFilename);
+	if (statistics.timedOut)
+		return "timeout";
+	else if (statistics.terminationSignal != 0)
+		return "signal " + std::to_string(statistics.terminationSignal);
+	else
+		return std::to_string(statistics.exitCode);
+}
+
+// Resource limits of the competitor processes started by one worker.
+struct ProcessLimits
+{
+	// CPUs the competitor may run on (empty = any), enforced through the affinity of the worker thread, which the competitor inherits.
+	std::vector<uint> cpus;
+
+	// CPU core budget (0 = unlimited), also passed to the competitor as thread count of OpenCV and OpenMP.
+	uint numCores = 0;
+
+	// Enforced through the cgroup if there is one, otherwise as address-space limit (0 = unlimited).
+	size_t memoryLimitBytes = 0;
+
+	// Only enforced through a cgroup (0 = unlimited).
+	uint maxThreads = 0;
 
+	// Delegated cgroup v2 directory below which each run gets its own cgroup (empty = none).
+	std::string cgroupDirectory;
+};
+
+ProcessLimits getProcessLimits(const EvaluationOptions& options, uint workerNo)
+{
+	ProcessLimits limits;
+	uint numCpus = std::max(1u, std::thread::hardware_concurrency());
+	if (options.cpuLimit != 0)
+	{
+		// Consecutive CPU sets, disjoint between the workers as long as there are enough CPUs.
+		for (uint i = 0; i < std::min(options.cpuLimit, numCpus); ++i)
+			limits.cpus.push_back((workerNo * options.cpuLimit + i) % numCpus);
+		limits.numCores = options.cpuLimit;
+	}
+	else if (options.pinWorkers)
+		limits.cpus.push_back(workerNo % numCpus);
+
+	limits.memoryLimitBytes = static_cast<size_t>(options.memoryLimitMb) << 20;
+	limits.maxThreads = options.threadLimit;
+	limits.cgroupDirectory = options.cgroupDirectory;
+	return limits;
+}
+
+// The same for all runs of an evaluation. Recorded in "Runs.csv" and part of the result cache key, so that only runs under the same budget are compared.
+std::string describeResourcePolicy(const EvaluationOptions& options)
+{
 #if _WIN32
-	SHELLEXECUTEINFOA shellExecuteInfo = { sizeof(shellExecuteInfo) };
-	shellExecuteInfo.fMask = SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI | SEE_MASK_NO_CONSOLE;
-	shellExecuteInfo.lpVerb = "open";
-	shellExecuteInfo.lpFile = competitor.executablePath.c_str();
-	std::string parameters = "\"" + videoBasename + ".avi\" \"" + detectionResultFilename + '"';
-	shellExecuteInfo.lpParameters = parameters.c_str();
+	const bool enforced = false;
 #elif __unix__
-	std::string commandLine = "timeout --signal=KILL " + std::to_string(timeoutMs / 1000.0) + "s \"" + competitor.executablePath + "\" \"" + videoBasename + ".avi\" \"" + detectionResultFilename + '"';
+	const bool enforced = true;
+#endif
+	bool cgroup = enforced && !options.cgroupDirectory.empty();
+	std::ostringstream stream;
+	stream << "cpus=" << (options.cpuLimit != 0 ? std::to_string(options.cpuLimit) : options.pinWorkers ? "1" : "all");
+	stream << " memory=" << (options.memoryLimitMb != 0 ? std::to_string(options.memoryLimitMb) + (cgroup ? "MiB/cgroup" : enforced ? "MiB/address-space" : "MiB/unenforced") : "unlimited");
+	stream << " threads=" << (options.threadLimit != 0 ? std::to_string(options.threadLimit) + (cgroup ? "/cgroup" : "/unenforced") : "unlimited");
+	if (enforced && options.persistentCompetitors)
+		stream << " launch=persistent";
+	return stream.str();
+}
+
+#if __unix__
+bool writeTextFile(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename);
+	file << text;
+	file.flush();
+	return static_cast<bool>(file);
+}
+
+// Enables the controllers needed for the limits in the delegated cgroup directory.
+bool prepareCgroupDirectory(const std::string& cgroupDirectory)
+{
+	return writeTextFile(cgroupDirectory + "/cgroup.subtree_control", "+cpu +memory +pids");
+}
+
+// Own cgroup (v2) of a single competitor run. Destroying it kills whatever is left in it (e.g. processes that left the process group) and removes it.
+class RunCgroup
+{
+public:
+	explicit RunCgroup(const ProcessLimits& limits)
+	{
+		static std::atomic<uint> nextCgroupNo{ 0 };
+		std::string cgroupDirectory = limits.cgroupDirectory + "/dice-" + std::to_string(getpid()) + '-' + std::to_string(nextCgroupNo++);
+		if (mkdir(cgroupDirectory.c_str(), 0755) != 0)
+			return;
+
+		directory = cgroupDirectory;
+		valid = (limits.numCores == 0 || writeTextFile(directory + "/cpu.max", std::to_string(limits.numCores * 100000) + " 100000"))
+			&& (limits.memoryLimitBytes == 0 || writeTextFile(directory + "/memory.max", std::to_string(limits.memoryLimitBytes)))
+			&& (limits.maxThreads == 0 || writeTextFile(directory + "/pids.max", std::to_string(limits.maxThreads)));
+
+		// Does not exist without swap accounting.
+		if (limits.memoryLimitBytes != 0)
+			writeTextFile(directory + "/memory.swap.max", "0");
+		procsFilename = directory + "/cgroup.procs";
+	}
+
+	RunCgroup(const RunCgroup&) = delete;
+	RunCgroup& operator=(const RunCgroup&) = delete;
+
+	~RunCgroup()
+	{
+		if (directory.empty())
+			return;
+
+		writeTextFile(directory + "/cgroup.kill", "1");
+		for (int i = 0; i < 100 && rmdir(directory.c_str()) != 0 && errno == EBUSY; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	bool isValid() const
+	{
+		return valid;
+	}
+
+	const std::string& getProcsFilename() const
+	{
+		return procsFilename;
+	}
+
+private:
+	std::string directory;
+	std::string procsFilename;
+	bool valid = false;
+};
+
+// Creates the cgroup of a run if the limits ask for one. Without it (also if creating it failed, with a warning) the memory limit falls back to an address-space limit.
+std::unique_ptr<RunCgroup> createRunCgroup(const ProcessLimits& limits)
+{
+	if (limits.cgroupDirectory.empty())
+		return nullptr;
+
+	auto p_cgroup = std::make_unique<RunCgroup>(limits);
+	if (p_cgroup->isValid())
+		return p_cgroup;
+
+	static std::atomic<bool> warningShown{ false };
+	if (!warningShown.exchange(true))
+		std::cerr << "Failed to create a cgroup with the resource limits below \"" << limits.cgroupDirectory << "\", the competitors run without one!" << std::endl;
+	return nullptr;
+}
+
+// Called in the forked child before it runs the competitor, so only async-signal-safe calls are allowed here.
+bool applyLimitsInChild(const char* p_cgroupProcsFilename, size_t addressSpaceLimitBytes)
+{
+	if (p_cgroupProcsFilename)
+	{
+		int fd = open(p_cgroupProcsFilename, O_WRONLY);
+		if (fd == -1)
+			return false;
+		bool joined = write(fd, "0", 1) == 1;
+		close(fd);
+		if (!joined)
+			return false;
+	}
+
+	if (addressSpaceLimitBytes != 0)
+	{
+		rlimit limit = { addressSpaceLimitBytes, addressSpaceLimitBytes };
+		if (setrlimit(RLIMIT_AS, &limit) != 0)
+			return false;
+	}
+
+	return true;
+}
 #endif
 
+#if __unix__
+// Kills the child's process group when the timeout expires and reaps the child through wait4 to get its resource usage.
+void superviseProcess(pid_t pid, int64 t0, uint timeoutMs, RunStatistics& outStatistics)
+{
+	std::mutex watchdogMutex;
+	std::condition_variable watchdogCondition;
+	bool childExited = false;
+	bool killSent = false;
+	std::thread watchdog([&]()
+	{
+		std::unique_lock<std::mutex> lock(watchdogMutex);
+		if (watchdogCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() { return childExited; }))
+			return;
+
+		// The child may have exited just before the deadline, before the main thread could report it. It is not reaped before this thread is joined, so the check is reliable.
+		siginfo_t exitInfo = {};
+		if (waitid(P_PID, pid, &exitInfo, WEXITED | WNOHANG | WNOWAIT) == 0 && exitInfo.si_pid != 0)
+			return;
+		kill(-pid, SIGKILL);
+		killSent = true;
+	});
+
+	// Wait without reaping first, so the watchdog can never hit a recycled process ID.
+	siginfo_t info;
+	while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1 && errno == EINTR);
+	outStatistics.wallTimeMs = static_cast<uint>(1000 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+	{
+		std::lock_guard<std::mutex> lock(watchdogMutex);
+		childExited = true;
+	}
+	watchdogCondition.notify_one();
+	watchdog.join();
+
+	int status = 0;
+	rusage usage = {};
+	while (wait4(pid, &status, 0, &usage) == -1 && errno == EINTR);
+	outStatistics.userTimeMs = static_cast<uint>(usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000);
+	outStatistics.systemTimeMs = static_cast<uint>(usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000);
+	outStatistics.peakRssKb = static_cast<size_t>(usage.ru_maxrss);
+	if (WIFEXITED(status))
+		outStatistics.exitCode = WEXITSTATUS(status);
+	else if (WIFSIGNALED(status))
+		outStatistics.terminationSignal = WTERMSIG(status);
+
+	// Only a child that the kill reached before it exited by itself has timed out.
+	outStatistics.timedOut = killSent && WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL;
+}
+
+// The argument vector for execve, pointing into the given strings.
+std::vector<char*> makeArgumentVector(const std::vector<std::string>& arguments)
+{
+	std::vector<char*> argv;
+	for (const std::string& argument : arguments)
+		argv.push_back(const_cast<char*>(argument.c_str()));
+	argv.push_back(nullptr);
+	return argv;
+}
+
+// The environment for execve: the inherited variables plus the additional ones ("NAME=value"), which replace inherited ones of the same name.
+std::vector<char*> makeEnvironment(const std::vector<std::string>& additionalEnvironment)
+{
+	std::vector<char*> envp;
+	for (char** pp_variable = environ; *pp_variable; ++pp_variable)
+	{
+		std::string variable = *pp_variable;
+		std::string name = variable.substr(0, variable.find('=') + 1);
+		if (std::none_of(additionalEnvironment.begin(), additionalEnvironment.end(), [&](const std::string& additionalVariable) { return additionalVariable.compare(0, name.size(), name) == 0; }))
+			envp.push_back(*pp_variable);
+	}
+	for (const std::string& variable : additionalEnvironment)
+		envp.push_back(const_cast<char*>(variable.c_str()));
+	envp.push_back(nullptr);
+	return envp;
+}
+
+// Starts the competitor directly (no shell, no "timeout" process) in its own process group. The additional environment variables are given as "NAME=value".
+// Memory limits and cgroups have to be applied in the child before it runs the competitor, which needs fork instead of posix_spawn.
+bool runProcess(const std::vector<std::string>& arguments, uint timeoutMs, RunStatistics& outStatistics, const std::vector<std::string>& additionalEnvironment = {}, const ProcessLimits& limits = ProcessLimits())
+{
+	std::vector<char*> argv = makeArgumentVector(arguments);
+	std::vector<char*> envp = makeEnvironment(additionalEnvironment);
+
+	std::unique_ptr<RunCgroup> p_cgroup = createRunCgroup(limits);
+	if (p_cgroup || limits.memoryLimitBytes != 0)
+	{
+		const char* p_cgroupProcsFilename = p_cgroup ? p_cgroup->getProcsFilename().c_str() : nullptr;
+		size_t addressSpaceLimitBytes = p_cgroup ? 0 : limits.memoryLimitBytes;
+		int64 t0 = cv::getTickCount();
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			setpgid(0, 0);
+			if (applyLimitsInChild(p_cgroupProcsFilename, addressSpaceLimitBytes))
+				execve(argv[0], argv.data(), envp.data());
+			_exit(127);
+		}
+		else if (pid == -1)
+		{
+			outStatistics.exitCode = 127;
+			return false;
+		}
+
+		setpgid(pid, pid);
+		superviseProcess(pid, t0, timeoutMs, outStatistics);
+		return true;
+	}
+
+	posix_spawnattr_t spawnAttributes;
+	posix_spawnattr_init(&spawnAttributes);
+	posix_spawnattr_setflags(&spawnAttributes, POSIX_SPAWN_SETPGROUP);
+	posix_spawnattr_setpgroup(&spawnAttributes, 0);
+
 	int64 t0 = cv::getTickCount();
+	pid_t pid;
+	int spawnError = posix_spawn(&pid, argv[0], nullptr, &spawnAttributes, argv.data(), envp.data());
+	posix_spawnattr_destroy(&spawnAttributes);
+	if (spawnError != 0)
+	{
+		outStatistics.exitCode = 127;
+		return false;
+	}
 
-#ifdef _WIN32
-	if (ShellExecuteExA(&shellExecuteInfo))
-		if (WaitForSingleObject(shellExecuteInfo.hProcess, timeoutMs) == WAIT_TIMEOUT)
-			TerminateProcess(shellExecuteInfo.hProcess, 1);
+	superviseProcess(pid, t0, timeoutMs, outStatistics);
+	return true;
+}
+
+// A competitor executable that is started once in worker mode and then runs one video after the other, which saves the process start, the interpreter start-up and the library loading per video. The worker protocol, one line each:
+// - The competitor is started with the single argument "--worker" and writes "ready" to stdout once it has initialized.
+// - The evaluation writes a request "<video filename>\t<detection result filename>\t<shared frames segment name>" to the competitor's stdin (the segment name is empty without shared frames).
+// - The competitor writes the detection result file like in single-shot mode, then "done <status>" to stdout (status 0 = success). Other lines on stdout are passed on.
+// - Closing stdin asks the competitor to exit.
+// Each request is supervised like a single-shot run: when the timeout expires, the competitor's process group (and cgroup) is killed, and a competitor that crashed or was killed is started again for the next request. Only the time from the request to its completion line is measured.
+class PersistentCompetitorProcess
+{
+public:
+	// The limits apply to the competitor process as a whole, i.e. the cgroup lives as long as the process.
+	PersistentCompetitorProcess(const std::string& executablePath, const std::vector<std::string>& additionalEnvironment, const ProcessLimits& limits)
+		: executablePath(executablePath), additionalEnvironment(additionalEnvironment), limits(limits)
+	{
+	}
+
+	PersistentCompetitorProcess(const PersistentCompetitorProcess&) = delete;
+	PersistentCompetitorProcess& operator=(const PersistentCompetitorProcess&) = delete;
+
+	~PersistentCompetitorProcess()
+	{
+		if (pid != -1)
+			stop(EXIT_GRACE_PERIOD_MS);
+	}
+
+	// Runs one video, starting the competitor first if necessary (the start-up gets the same timeout, but is not measured). Returns false if the competitor could not be started.
+	bool run(const std::string& videoFilename, const std::string& detectionResultFilename, const std::string& sharedFramesSegmentName, uint timeoutMs, RunStatistics& outStatistics)
+	{
+		// A competitor that exited after its last request is not charged for it.
+		siginfo_t info = {};
+		if (pid != -1 && waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0)
+			stop(0);
+		if (pid == -1 && !start(timeoutMs, outStatistics))
+			return false;
+
+		// Resets the peak RSS of the process (Linux 4.0 and later), so that it is measured per request.
+		writeTextFile("/proc/" + std::to_string(pid) + "/clear_refs", "5");
+		CpuTimes cpuTimes0 = readCpuTimes();
+		int64 t0 = cv::getTickCount();
+		std::string status;
+		Completion completion = writeRequest(videoFilename + '\t' + detectionResultFilename + '\t' + sharedFramesSegmentName + '\n') ? waitForLine("done", t0, timeoutMs, status) : Completion::EXITED;
+		outStatistics.wallTimeMs = static_cast<uint>(1000 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+		if (completion == Completion::COMPLETED)
+		{
+			CpuTimes cpuTimes1 = readCpuTimes();
+			outStatistics.userTimeMs = static_cast<uint>(cpuTimes1.userTimeMs - std::min(cpuTimes0.userTimeMs, cpuTimes1.userTimeMs));
+			outStatistics.systemTimeMs = static_cast<uint>(cpuTimes1.systemTimeMs - std::min(cpuTimes0.systemTimeMs, cpuTimes1.systemTimeMs));
+			outStatistics.peakRssKb = readPeakRssKb();
+			std::istringstream statusStream(status);
+			if (!(statusStream >> outStatistics.exitCode))
+				outStatistics.exitCode = 1;
+			return true;
+		}
+
+		// The resource usage of a competitor that did not complete the request is only known for its whole lifetime.
+		outStatistics.timedOut = completion == Completion::TIMED_OUT;
+		rusage usage = stop(0, &outStatistics);
+		outStatistics.userTimeMs = static_cast<uint>(std::max<int64_t>(0, usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000 - static_cast<int64_t>(cpuTimes0.userTimeMs)));
+		outStatistics.systemTimeMs = static_cast<uint>(std::max<int64_t>(0, usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000 - static_cast<int64_t>(cpuTimes0.systemTimeMs)));
+		outStatistics.peakRssKb = static_cast<size_t>(usage.ru_maxrss);
+		return true;
+	}
+
+private:
+	enum class Completion { COMPLETED, EXITED, TIMED_OUT };
+
+	struct CpuTimes
+	{
+		uint64_t userTimeMs = 0;
+		uint64_t systemTimeMs = 0;
+	};
+
+	// Time a competitor gets to exit by itself after its stdin was closed.
+	enum { EXIT_GRACE_PERIOD_MS = 1000 };
+
+	bool start(uint timeoutMs, RunStatistics& outStatistics)
+	{
+		// Close-on-exec, so that competitors started concurrently by other workers do not inherit the pipes (and keep them open).
+		int requestPipe[2], responsePipe[2];
+		if (pipe2(requestPipe, O_CLOEXEC) != 0)
+		{
+			outStatistics.exitCode = 127;
+			return false;
+		}
+		if (pipe2(responsePipe, O_CLOEXEC) != 0)
+		{
+			close(requestPipe[0]);
+			close(requestPipe[1]);
+			outStatistics.exitCode = 127;
+			return false;
+		}
+
+		std::vector<std::string> arguments = { executablePath, "--worker" };
+		std::vector<char*> argv = makeArgumentVector(arguments);
+		std::vector<char*> envp = makeEnvironment(additionalEnvironment);
+		p_cgroup = createRunCgroup(limits);
+		const char* p_cgroupProcsFilename = p_cgroup ? p_cgroup->getProcsFilename().c_str() : nullptr;
+		size_t addressSpaceLimitBytes = p_cgroup ? 0 : limits.memoryLimitBytes;
+		pid = fork();
+		if (pid == 0)
+		{
+			// The duplicated descriptors do not inherit close-on-exec.
+			setpgid(0, 0);
+			if (dup2(requestPipe[0], STDIN_FILENO) != -1 && dup2(responsePipe[1], STDOUT_FILENO) != -1 && applyLimitsInChild(p_cgroupProcsFilename, addressSpaceLimitBytes))
+				execve(argv[0], argv.data(), envp.data());
+			_exit(127);
+		}
+
+		close(requestPipe[0]);
+		close(responsePipe[1]);
+		if (pid == -1)
+		{
+			close(requestPipe[1]);
+			close(responsePipe[0]);
+			p_cgroup.reset();
+			outStatistics.exitCode = 127;
+			return false;
+		}
+		setpgid(pid, pid);
+		requestFd = requestPipe[1];
+		responseFd = responsePipe[0];
+
+		std::string readyArguments;
+		Completion completion = waitForLine("ready", cv::getTickCount(), timeoutMs, readyArguments);
+		if (completion == Completion::COMPLETED)
+			return true;
+
+		outStatistics.timedOut = completion == Completion::TIMED_OUT;
+		stop(0, &outStatistics);
+		std::cerr << "Failed to start competitor \"" << executablePath << "\" in worker mode (exit status: " << describeExitStatus(outStatistics) << ")!" << std::endl;
+		return false;
+	}
+
+	// Kills what is left of the competitor (its process group and cgroup) and reaps it, after waiting up to the grace period for it to exit by itself on the closed stdin. Returns the resource usage of the competitor's lifetime.
+	rusage stop(uint gracePeriodMs, RunStatistics* p_outStatistics = nullptr)
+	{
+		close(requestFd);
+		int64 t0 = cv::getTickCount();
+		siginfo_t info = {};
+		while (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0 && 1000 * (cv::getTickCount() - t0) / cv::getTickFrequency() < gracePeriodMs)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		// The competitor is not reaped yet, so its process ID cannot have been recycled.
+		kill(-pid, SIGKILL);
+		p_cgroup.reset();
+		int status = 0;
+		rusage usage = {};
+		while (wait4(pid, &status, 0, &usage) == -1 && errno == EINTR);
+		if (p_outStatistics && WIFEXITED(status))
+			p_outStatistics->exitCode = WEXITSTATUS(status);
+		else if (p_outStatistics && WIFSIGNALED(status))
+			p_outStatistics->terminationSignal = WTERMSIG(status);
+
+		close(responseFd);
+		pid = -1;
+		requestFd = -1;
+		responseFd = -1;
+		responseBuffer.clear();
+		return usage;
+	}
+
+	bool writeRequest(const std::string& request)
+	{
+		for (size_t offset = 0; offset < request.size();)
+		{
+			ssize_t numBytesWritten = write(requestFd, request.data() + offset, request.size() - offset);
+			if (numBytesWritten == -1 && errno == EINTR)
+				continue;
+			if (numBytesWritten <= 0)
+				return false;
+			offset += static_cast<size_t>(numBytesWritten);
+		}
+		return true;
+	}
+
+	// Waits until the competitor writes the keyword line (the rest of the line goes into outArguments) or closes its stdout, at most until the timeout (counted from t0) expires.
+	Completion waitForLine(const std::string& keyword, int64 t0, uint timeoutMs, std::string& outArguments)
+	{
+		for (;;)
+		{
+			size_t lineEnd = responseBuffer.find('\n');
+			if (lineEnd != std::string::npos)
+			{
+				std::string line = responseBuffer.substr(0, lineEnd);
+				responseBuffer.erase(0, lineEnd + 1);
+				if (line.compare(0, keyword.size(), keyword) == 0 && (line.size() == keyword.size() || line[keyword.size()] == ' '))
+				{
+					outArguments = line.substr(std::min(line.size(), keyword.size() + 1));
+					return Completion::COMPLETED;
+				}
+				std::cout << line << std::endl;
+				continue;
+			}
+
+			int64 elapsedMs = 1000 * (cv::getTickCount() - t0) / cv::getTickFrequency();
+			if (elapsedMs >= timeoutMs)
+				return Completion::TIMED_OUT;
+			pollfd responsePollFd = { responseFd, POLLIN, 0 };
+			int numReady = poll(&responsePollFd, 1, static_cast<int>(timeoutMs - elapsedMs));
+			if (numReady == -1 && errno == EINTR)
+				continue;
+			if (numReady == 0)
+				return Completion::TIMED_OUT;
+
+			char buffer[4096];
+			ssize_t numBytesRead = numReady == -1 ? -1 : read(responseFd, buffer, sizeof(buffer));
+			if (numBytesRead == -1 && errno == EINTR)
+				continue;
+			if (numBytesRead <= 0)
+				return Completion::EXITED;
+			responseBuffer.append(buffer, static_cast<size_t>(numBytesRead));
+		}
+	}
+
+	// CPU time of all threads of the competitor so far, from /proc/<pid>/stat (zero where that is not available).
+	CpuTimes readCpuTimes() const
+	{
+		CpuTimes cpuTimes;
+		std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+		std::string stat;
+		std::getline(file, stat);
+
+		// The command name in parentheses may contain spaces. It is followed by fields 3 to 13, then utime and stime in clock ticks.
+		size_t commandEnd = stat.rfind(')');
+		if (commandEnd == std::string::npos)
+			return cpuTimes;
+		std::istringstream stream(stat.substr(commandEnd + 1));
+		std::string field;
+		for (int fieldNo = 3; fieldNo <= 13; ++fieldNo)
+			stream >> field;
+		uint64_t userTicks, systemTicks;
+		long ticksPerSecond = sysconf(_SC_CLK_TCK);
+		if (stream >> userTicks >> systemTicks && ticksPerSecond > 0)
+		{
+			cpuTimes.userTimeMs = userTicks * 1000 / ticksPerSecond;
+			cpuTimes.systemTimeMs = systemTicks * 1000 / ticksPerSecond;
+		}
+		return cpuTimes;
+	}
+
+	// Peak RSS since the last reset through clear_refs, from /proc/<pid>/status (0 where that is not available).
+	size_t readPeakRssKb() const
+	{
+		std::ifstream file("/proc/" + std::to_string(pid) + "/status");
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t peakRssKb;
+			if (line.compare(0, 6, "VmHWM:") == 0 && std::istringstream(line.substr(6)) >> peakRssKb)
+				return peakRssKb;
+		}
+		return 0;
+	}
+
+	const std::string executablePath;
+	const std::vector<std::string> additionalEnvironment;
+	const ProcessLimits limits;
+	pid_t pid = -1;
+	int requestFd = -1;
+	int responseFd = -1;
+	std::string responseBuffer;
+	std::unique_ptr<RunCgroup> p_cgroup;
+};
+#endif
+
+// A competitor built as a shared library (see DICE_DETECTION_PLUGIN in "Template.cpp"). detectDice is called in-process on a video capture opened by the harness, which saves the process start, the dynamic linking and the OpenCV initialization per video.
+// Calls into the same plugin are serialized, since competitors are not written to be thread-safe.
+// With isolation, each call happens in a child process instead, so a crash or a timeout cannot take down the harness (Linux only, elsewhere the call stays in-process). The child is this program, executed anew as plugin host (see runPlugin), which loads and checks the plugin. The harness itself never loads an isolated plugin.
+class CompetitorPlugin
+{
+public:
+	typedef void (*AddDieFunction)(void* p_context, int x, int y, uint value);
+	typedef void (*AddStageTimeFunction)(void* p_context, const char* p_stageName, double milliseconds);
+	typedef void (*AddCounterFunction)(void* p_context, const char* p_counterName, int64_t value);
+	typedef uint (*VersionFunction)();
+	typedef int (*DetectFunction)(cv::VideoCapture* p_videoCapture, uint* p_outReferenceFrameNo, AddDieFunction p_addDie, AddStageTimeFunction p_addStageTime, AddCounterFunction p_addCounter, void* p_context);
+
+	static const uint ABI_VERSION = 2;
+
+	CompetitorPlugin(const std::string& filename, bool isolated)
+		: filename(filename), isolated(isolated && isIsolationSupported())
+	{
+		if (this->isolated)
+		{
+			if (!std::ifstream(filename))
+				throw std::runtime_error("Failed to read competitor plugin \"" + filename + "\"!");
+			return;
+		}
+
+#if _WIN32
+		p_library = LoadLibraryA(filename.c_str());
+		if (!p_library)
+			throw std::runtime_error("Failed to load competitor plugin \"" + filename + "\"!");
+		VersionFunction p_version = reinterpret_cast<VersionFunction>(GetProcAddress(p_library, "diceDetectionPluginVersion"));
+		p_detect = reinterpret_cast<DetectFunction>(GetProcAddress(p_library, "diceDetectionPluginDetect"));
 #elif __unix__
-	int unusedResult = std::system(commandLine.c_str());
+		p_library = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (!p_library)
+			throw std::runtime_error("Failed to load competitor plugin \"" + filename + "\": " + dlerror());
+		VersionFunction p_version = reinterpret_cast<VersionFunction>(dlsym(p_library, "diceDetectionPluginVersion"));
+		p_detect = reinterpret_cast<DetectFunction>(dlsym(p_library, "diceDetectionPluginDetect"));
 #endif
+		if (!p_version || !p_detect || p_version() != ABI_VERSION)
+		{
+			unload();
+			throw std::runtime_error("The competitor plugin \"" + filename + "\" does not export a compatible plugin interface (version " + std::to_string(ABI_VERSION) + ")!");
+		}
+	}
 
-	outRunningTime = static_cast<uint>(1000 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+	CompetitorPlugin(const CompetitorPlugin&) = delete;
+	CompetitorPlugin& operator=(const CompetitorPlugin&) = delete;
 
-	if (!fs::is_regular_file(detectionResultFilename))
+	~CompetitorPlugin()
+	{
+		unload();
+	}
+
+	// The plugin host is started through /proc/self/exe.
+	static bool isIsolationSupported()
+	{
+#if __linux__
+		return true;
+#else
 		return false;
+#endif
+	}
+
+	static bool isPluginFilename(const std::string& filename)
+	{
+		std::string extension = fs::path(filename).extension().string();
+		return extension == ".so" || extension == ".dll" || extension == ".dylib";
+	}
+
+	const std::string& getFilename() const
+	{
+		return filename;
+	}
+
+	bool isIsolated() const
+	{
+		return isolated;
+	}
+
+	bool detect(const std::string& videoFilename, DetectionResult& outDetectionResult) const
+	{
+		cv::VideoCapture videoCapture(videoFilename);
+		if (!videoCapture.isOpened())
+			return false;
+
+		DetectionResult detectionResult;
+		AddDieFunction p_addDie = [](void* p_context, int x, int y, uint value) { static_cast<DetectionResult*>(p_context)->detectedDice.push_back({ cv::Point(x, y), value }); };
+		AddStageTimeFunction p_addStageTime = [](void* p_context, const char* p_stageName, double milliseconds) { static_cast<DetectionResult*>(p_context)->stageTimesMs.emplace_back(p_stageName, milliseconds); };
+		AddCounterFunction p_addCounter = [](void* p_context, const char* p_counterName, int64_t value) { static_cast<DetectionResult*>(p_context)->counters.emplace_back(p_counterName, value); };
+		std::lock_guard<std::mutex> lock(mutex);
+		if (p_detect(&videoCapture, &detectionResult.referenceFrameNo, p_addDie, p_addStageTime, p_addCounter, &detectionResult) != 0)
+			return false;
+
+		outDetectionResult = detectionResult;
+		return true;
+	}
+
+private:
+	void unload()
+	{
+#if _WIN32
+		if (p_library)
+			FreeLibrary(p_library);
+#elif __unix__
+		if (p_library)
+			dlclose(p_library);
+#endif
+		p_library = nullptr;
+	}
+
+	const std::string filename;
+	const bool isolated;
+#if _WIN32
+	HMODULE p_library = nullptr;
+#elif __unix__
+	void* p_library = nullptr;
+#endif
+	DetectFunction p_detect = nullptr;
+	mutable std::mutex mutex;
+};
+
+// Runs the plugin on the video and writes its result file like a competitor process would.
+bool detectAndWriteResult(const CompetitorPlugin& plugin, const std::string& videoFilename, const std::string& detectionResultFilename)
+{
+	DetectionResult detectionResult;
+	if (!plugin.detect(videoFilename, detectionResult))
+		return false;
+	std::ofstream file(detectionResultFilename);
+	writeDetectionResult(file, detectionResult);
+	return static_cast<bool>(file);
+}
+
+// The environment variables that announce the core budget to a competitor process, as most competitors size their thread pools by the number of CPUs.
+std::vector<std::string> getCoreBudgetEnvironment(const ProcessLimits& limits)
+{
+	std::vector<std::string> environment;
+	if (limits.numCores != 0)
+		for (const char* p_variableName : { "OPENCV_FOR_THREADS_NUM", "OPENCV_NUM_THREADS", "OMP_NUM_THREADS" })
+			environment.push_back(std::string(p_variableName) + '=' + std::to_string(limits.numCores));
+	return environment;
+}
+
+#if __linux__
+// Command line option of the plugin host mode, in which the evaluation runs a single video through an isolated plugin (see runPlugin).
+const std::string PLUGIN_HOST_OPTION = "--plugin-host";
+
+// Returns the exit status of the plugin host process.
+int runPluginHost(const std::string& pluginFilename, const std::string& videoFilename, const std::string& detectionResultFilename)
+{
+	try
+	{
+		CompetitorPlugin plugin(pluginFilename, false);
+		return detectAndWriteResult(plugin, videoFilename, detectionResultFilename) ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
+
+// Runs the plugin and writes its result file like a competitor process would.
+// The resource limits (except for the CPU affinity) only apply to isolated plugins.
+void runPlugin(const CompetitorPlugin& plugin, const std::string& videoFilename, const std::string& detectionResultFilename, uint timeoutMs, const ProcessLimits& limits, RunStatistics& outStatistics)
+{
+#if __unix__
+#if __linux__
+	// An isolated plugin runs in a new process of this program (/proc/self/exe) in plugin host mode, started and supervised like a competitor executable.
+	// Forking the evaluation itself would not be safe: its other threads may hold locks (of the allocator, OpenCV or FFmpeg) at the time of the fork, which would never be released in the child.
+	if (plugin.isIsolated())
+	{
+		runProcess({ "/proc/self/exe", PLUGIN_HOST_OPTION, plugin.getFilename(), videoFilename, detectionResultFilename }, timeoutMs, outStatistics, getCoreBudgetEnvironment(limits), limits);
+		return;
+	}
+#endif
+
+	rusage usage0 = {};
+	getrusage(RUSAGE_THREAD, &usage0);
+#endif
+
+	// In-process calls cannot be interrupted. A call that exceeds the timeout counts as timed out and its result is discarded.
+	int64 t0 = cv::getTickCount();
+	bool success = detectAndWriteResult(plugin, videoFilename, detectionResultFilename);
+	outStatistics.wallTimeMs = static_cast<uint>(1000 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+	outStatistics.exitCode = success ? 0 : 1;
+	if (outStatistics.wallTimeMs > timeoutMs)
+	{
+		outStatistics.timedOut = true;
+		fs::remove(detectionResultFilename);
+	}
+
+	// Only the calling thread's CPU time is known here (not that of OpenCV's worker threads), and the peak RSS is not attributable to a single call.
+#if __unix__
+	rusage usage1 = {};
+	getrusage(RUSAGE_THREAD, &usage1);
+	outStatistics.userTimeMs = static_cast<uint>((usage1.ru_utime.tv_sec - usage0.ru_utime.tv_sec) * 1000 + (usage1.ru_utime.tv_usec - usage0.ru_utime.tv_usec) / 1000);
+	outStatistics.systemTimeMs = static_cast<uint>((usage1.ru_stime.tv_sec - usage0.ru_stime.tv_sec) * 1000 + (usage1.ru_stime.tv_usec - usage0.ru_stime.tv_usec) / 1000);
+#endif
+}
+
+// The shared-frames segment (empty = none) is announced to the competitor process through the environment variable DICE_SHARED_FRAMES (Unix only). On Windows, only the CPU affinity of the limits is applied.
+// With a persistent process slot (Unix only, not for plugins), the video is passed to the competitor running in worker mode in that slot, which is (re)started as needed.
+bool callCompetitor(const Competitor& competitor, const std::string& videoBasename, const std::string& resultsDirectory, uint timeoutMs, const ProcessLimits& limits, const std::string& sharedFramesSegmentName, DetectionResult& outDetectionResult, RunStatistics& outStatistics, std::unique_ptr<PersistentCompetitorProcess>* pp_persistentProcess = nullptr)
+{
+	std::string detectionResultFilename = getDetectionResultFilename(resultsDirectory, videoBasename, competitor.name);
+	
+	if (fs::is_regular_file(detectionResultFilename))
+		fs::remove(detectionResultFilename);
+
+	outStatistics = RunStatistics();
+
+#if _WIN32
+	SHELLEXECUTEINFOA shellExecuteInfo = { sizeof(shellExecuteInfo) };
+	shellExecuteInfo.fMask = SEE_MASK_NOCLOSEPROCESS | SEE_MASK_FLAG_NO_UI | SEE_MASK_NO_CONSOLE;
+	shellExecuteInfo.lpVerb = "open";
+	shellExecuteInfo.lpFile = competitor.executablePath.c_str();
+	std::string parameters = "\"" + videoBasename + ".avi\" \"" + detectionResultFilename + '"';
+	shellExecuteInfo.lpParameters = parameters.c_str();
+
+	int64 t0 = cv::getTickCount();
+	if (competitor.p_plugin)
+		runPlugin(*competitor.p_plugin, videoBasename + ".avi", detectionResultFilename, timeoutMs, limits, outStatistics);
+	else if (ShellExecuteExA(&shellExecuteInfo) && shellExecuteInfo.hProcess)
+	{
+		DWORD_PTR affinityMask = 0;
+		for (uint cpuNo : limits.cpus)
+			affinityMask |= DWORD_PTR(1) << cpuNo;
+		if (affinityMask != 0)
+			SetProcessAffinityMask(shellExecuteInfo.hProcess, affinityMask);
+		if (WaitForSingleObject(shellExecuteInfo.hProcess, timeoutMs) == WAIT_TIMEOUT)
+		{
+			TerminateProcess(shellExecuteInfo.hProcess, 1);
+			WaitForSingleObject(shellExecuteInfo.hProcess, INFINITE);
+			outStatistics.timedOut = true;
+		}
+		outStatistics.wallTimeMs = static_cast<uint>(1000 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+
+		DWORD exitCode = 0;
+		GetExitCodeProcess(shellExecuteInfo.hProcess, &exitCode);
+		outStatistics.exitCode = static_cast<int>(exitCode);
+
+		// FILETIME values are in units of 100 ns.
+		FILETIME creationTime, exitTime, kernelTime, userTime;
+		if (GetProcessTimes(shellExecuteInfo.hProcess, &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			outStatistics.userTimeMs = static_cast<uint>((static_cast<uint64_t>(userTime.dwHighDateTime) << 32 | userTime.dwLowDateTime) / 10000);
+			outStatistics.systemTimeMs = static_cast<uint>((static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32 | kernelTime.dwLowDateTime) / 10000);
+		}
+
+		PROCESS_MEMORY_COUNTERS memoryCounters = { sizeof(memoryCounters) };
+		if (GetProcessMemoryInfo(shellExecuteInfo.hProcess, &memoryCounters, sizeof(memoryCounters)))
+			outStatistics.peakRssKb = memoryCounters.PeakWorkingSetSize / 1024;
+
+		CloseHandle(shellExecuteInfo.hProcess);
+	}
+#elif __unix__
+	// The competitor inherits the CPU affinity of the calling (already pinned) worker thread. The core budget is also announced, as most competitors size their thread pools by the number of CPUs.
+	if (competitor.p_plugin)
+		runPlugin(*competitor.p_plugin, videoBasename + ".avi", detectionResultFilename, timeoutMs, limits, outStatistics);
+	else
+	{
+		std::vector<std::string> additionalEnvironment = getCoreBudgetEnvironment(limits);
+		if (pp_persistentProcess)
+		{
+			// The shared-frames segment changes from video to video, so it comes with the request.
+			if (!*pp_persistentProcess)
+				*pp_persistentProcess = std::make_unique<PersistentCompetitorProcess>(competitor.executablePath, additionalEnvironment, limits);
+			(*pp_persistentProcess)->run(videoBasename + ".avi", detectionResultFilename, sharedFramesSegmentName, timeoutMs, outStatistics);
+		}
+		else
+		{
+			if (!sharedFramesSegmentName.empty())
+				additionalEnvironment.push_back("DICE_SHARED_FRAMES=" + sharedFramesSegmentName);
+			runProcess({ competitor.executablePath, videoBasename + ".avi", detectionResultFilename }, timeoutMs, outStatistics, additionalEnvironment, limits);
+		}
+	}
+#endif
+
+	if (!fs::is_regular_file(detectionResultFilename))
+		return false;
+
+	try
+	{
+		outDetectionResult = loadDetectionResult(detectionResultFilename);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Only runs with a result count, the stage times of the others are unreliable.
+void addToStageBreakdown(const DetectionResult& detectionResult, uint wallTimeMs, StageBreakdown& breakdown)
+{
+	++breakdown.numVideos;
+	breakdown.wallTimeMs += wallTimeMs;
+	auto add = [](auto& items, const auto& item)
+	{
+		for (auto& existingItem : items)
+			if (existingItem.first == item.first)
+			{
+				existingItem.second += item.second;
+				return;
+			}
+		items.push_back(item);
+	};
+	for (const auto& stageTime : detectionResult.stageTimesMs)
+		add(breakdown.stageTimesMs, stageTime);
+	for (const auto& counter : detectionResult.counters)
+		add(breakdown.counters, counter);
+}
+
+// Uses the nearest-rank method for the percentiles.
+LatencySummary summarizeLatencies(std::vector<uint> latenciesMs)
+{
+	LatencySummary summary;
+	if (latenciesMs.empty())
+		return summary;
+
+	std::sort(latenciesMs.begin(), latenciesMs.end());
+	auto percentile = [&](double p) { return latenciesMs[static_cast<size_t>(std::max(1.0, std::ceil(p * latenciesMs.size()))) - 1]; };
+	summary.minMs = latenciesMs.front();
+	summary.medianMs = percentile(0.5);
+	summary.p95Ms = percentile(0.95);
+	summary.maxMs = latenciesMs.back();
+	return summary;
+}
+
+// Only possible where the OS lets us drop clean pages of a single file (posix_fadvise on Unix, no special privileges required).
+bool evictFileFromPageCache(const std::string& filename)
+{
+#if _WIN32
+	return false;
+#elif __unix__
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	bool success = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return success;
+#endif
+}
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// FNV-1a (64 bit), continuing from the given hash.
+uint64_t hashBytes(const char* p_bytes, size_t numBytes, uint64_t hash = FNV_OFFSET_BASIS)
+{
+	for (size_t i = 0; i < numBytes; ++i)
+		hash = (hash ^ static_cast<unsigned char>(p_bytes[i])) * 1099511628211ull;
+	return hash;
+}
+
+uint64_t hashString(const std::string& string)
+{
+	return hashBytes(string.data(), string.size());
+}
+
+// FNV-1a (64 bit) over the file contents.
+uint64_t hashFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("Failed to open file \"" + filename + "\" for hashing!");
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	char buffer[65536];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+		hash = hashBytes(buffer, static_cast<size_t>(file.gcount()), hash);
+
+	return hash;
+}
+
+// Name of a temporary file next to the given one, unique per process and thread. Written completely and then renamed to the given name, so that readers (also in other processes) never see a partial file.
+std::string getTemporaryFilename(const std::string& filename)
+{
+#if _WIN32
+	unsigned long processId = GetCurrentProcessId();
+#elif __unix__
+	pid_t processId = getpid();
+#endif
+	return filename + '.' + std::to_string(processId) + '-' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+}
+
+// Persistent cache of competitor runs, keyed by the content hashes of the competitor executable, the video and its groundtruth plus the scoring version.
+// Each pair is stored as soon as it finished, so a rerun only executes the pairs that changed and an interrupted evaluation resumes where it stopped.
+class ResultCache
+{
+public:
+	explicit ResultCache(const std::string& directory)
+		: directory(directory)
+	{
+		fs::create_directories(directory);
+	}
+
+	static uint64_t makeKey(uint64_t executableHash, uint64_t videoHash, uint64_t groundtruthHash, const std::string& resourcePolicy)
+	{
+		std::ostringstream keyStream;
+		keyStream << executableHash << ' ' << videoHash << ' ' << groundtruthHash << ' ' << SCORING_VERSION << ' ' << resourcePolicy;
+		return hashString(keyStream.str());
+	}
+
+	bool load(uint64_t key, CompetitorRun& outRun) const
+	{
+		std::ifstream file(getFilename(key));
+		std::string magic;
+		uint version;
+		file >> magic >> version;
+		if (!file || magic != "DICECACHE" || version != FORMAT_VERSION)
+			return false;
+
+		CompetitorRun run;
+		RunStatistics& statistics = run.statistics;
+		file >> run.gotResult >> statistics.wallTimeMs >> statistics.userTimeMs >> statistics.systemTimeMs >> statistics.peakRssKb >> statistics.exitCode;
+		if (!file || (run.gotResult && !readDetectionResult(file, run.detectionResult)))
+			return false;
+
+		run.fromCache = true;
+		outRun = run;
+		return true;
+	}
+
+	// Runs that timed out or crashed are not stored, they might have been disturbed from outside.
+	void store(uint64_t key, const CompetitorRun& run) const
+	{
+		const RunStatistics& statistics = run.statistics;
+		if (statistics.timedOut || statistics.terminationSignal != 0)
+			return;
+
+		std::string filename = getFilename(key);
+		std::string temporaryFilename = getTemporaryFilename(filename);
+		{
+			std::ofstream file(temporaryFilename);
+			file << "DICECACHE " << FORMAT_VERSION << std::endl;
+			file << run.gotResult << ' ' << statistics.wallTimeMs << ' ' << statistics.userTimeMs << ' ' << statistics.systemTimeMs << ' ' << statistics.peakRssKb << ' ' << statistics.exitCode << std::endl;
+			if (run.gotResult)
+				writeDetectionResult(file, run.detectionResult);
+			if (!file)
+				return;
+		}
+
+		// Renaming makes the entry appear atomically, an interruption never leaves a partial entry behind.
+		try
+		{
+			fs::rename(temporaryFilename, filename);
+		}
+		catch (const std::exception&)
+		{
+			fs::remove(temporaryFilename);
+		}
+	}
+
+	// Content hash of the file (see hashFile). The hashes are remembered in the cache directory, keyed by the absolute path, and a remembered hash is trusted as long as the size and modification time of the file are unchanged (like GroundtruthStore::lookup does for the JSON files).
+	uint64_t getFileHash(const std::string& filename) const
+	{
+		uint64_t size = static_cast<uint64_t>(fs::file_size(filename));
+		int64_t modificationTime = static_cast<int64_t>(fs::last_write_time(filename).time_since_epoch().count());
+		std::string hashFilename = getFilename(hashString(fs::absolute(filename).string()), "hash");
+		{
+			std::ifstream file(hashFilename);
+			std::string magic;
+			uint version;
+			uint64_t storedSize, hash;
+			int64_t storedModificationTime;
+			if (file >> magic >> version >> storedSize >> storedModificationTime >> std::hex >> hash && magic == "DICEHASH" && version == FORMAT_VERSION && storedSize == size && storedModificationTime == modificationTime)
+				return hash;
+		}
+
+		uint64_t hash = hashFile(filename);
+		std::string temporaryFilename = getTemporaryFilename(hashFilename);
+		{
+			std::ofstream file(temporaryFilename);
+			file << "DICEHASH " << FORMAT_VERSION << ' ' << size << ' ' << modificationTime << ' ' << std::hex << hash << std::endl;
+			if (!file)
+				return hash;
+		}
+		try
+		{
+			fs::rename(temporaryFilename, hashFilename);
+		}
+		catch (const std::exception&)
+		{
+			fs::remove(temporaryFilename);
+		}
+		return hash;
+	}
+
+private:
+	static const uint FORMAT_VERSION = 1;
+
+	std::string getFilename(uint64_t key, const std::string& extension = "txt") const
+	{
+		std::ostringstream filenameStream;
+		filenameStream << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << '.' << extension;
+		return filenameStream.str();
+	}
+
+	const std::string directory;
+};
+
+bool pinCurrentThreadToCpus(const std::vector<uint>& cpus)
+{
+#if _WIN32
+	DWORD_PTR affinityMask = 0;
+	for (uint cpuNo : cpus)
+		affinityMask |= DWORD_PTR(1) << cpuNo;
+	return SetThreadAffinityMask(GetCurrentThread(), affinityMask) != 0;
+#elif __unix__
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (uint cpuNo : cpus)
+		CPU_SET(cpuNo, &cpuSet);
+	return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#endif
+}
+
+// Header of the shared-memory segment for the competitors. The layout must match SharedFramesHeader in "Template-C++/SharedFrameSource.hpp".
+struct SharedFramesHeader
+{
+	enum State : uint32_t { DECODING = 0, END_OF_VIDEO = 1, CAPACITY_REACHED = 2, FAILED = 3 };
+
+	char magic[8];
+	char videoFilename[256];
+	uint32_t width;
+	uint32_t height;
+	int32_t type;
+	uint32_t capacity;
+	uint64_t frameOffset;
+	uint64_t frameStride;
+	double fps;
+	uint32_t numVideoFrames;
+
+	// Frames below numFramesReady are complete and never change again.
+	std::atomic<uint32_t> numFramesReady;
+	std::atomic<uint32_t> state;
+};
+
+// Decodes an evaluation video once into a POSIX shared-memory segment, so that competitors reading through SharedFrameSource do not have to decode it themselves.
+// A ring buffer would force all competitors of a video to run in lockstep, but they start at different times. So the frames stay until the last job of the video has finished; frames beyond the memory budget are decoded by the competitors themselves.
+// The frames are published progressively, but the scheduler waits until decoding is done before it times a competitor, so that no run is charged for the decoding.
+class SharedFrameServer
+{
+public:
+	// The video filename must be exactly the one passed to the competitors. The decoder thread runs on the given CPUs, or with idle priority if there are none, so that it does not take CPU time from the measured runs.
+	SharedFrameServer(const std::string& videoFilename, size_t budgetBytes, const std::vector<uint>& decoderCpus)
+		: decoderCpus(decoderCpus)
+	{
+#if __unix__
+		cv::Mat firstFrame;
+		if (!videoCapture.open(videoFilename) || !videoCapture.read(firstFrame) || !firstFrame.isContinuous() || videoFilename.size() >= sizeof(SharedFramesHeader::videoFilename))
+			return;
+
+		const size_t pageSize = 4096;
+		size_t frameOffset = (sizeof(SharedFramesHeader) + pageSize - 1) / pageSize * pageSize;
+		size_t frameStride = (firstFrame.total() * firstFrame.elemSize() + pageSize - 1) / pageSize * pageSize;
+		uint numVideoFrames = static_cast<uint>(std::max(0.0, videoCapture.get(cv::CAP_PROP_FRAME_COUNT)));
+		size_t capacity = budgetBytes / frameStride;
+		if (numVideoFrames != 0)
+			capacity = std::min<size_t>(capacity, numVideoFrames);
+		if (capacity == 0)
+			return;
+
+		static std::atomic<uint> nextSegmentNo{ 0 };
+		segmentName = "/dice-frames-" + std::to_string(getpid()) + '-' + std::to_string(nextSegmentNo++);
+		int fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd == -1)
+			return;
+
+		// The segment is sparse, memory is only used for the frames actually written.
+		mappingSize = frameOffset + capacity * frameStride;
+		void* p_mapping = MAP_FAILED;
+		if (ftruncate(fd, static_cast<off_t>(mappingSize)) == 0)
+			p_mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (p_mapping == MAP_FAILED)
+		{
+			shm_unlink(segmentName.c_str());
+			return;
+		}
+
+		p_header = new (p_mapping) SharedFramesHeader();
+		std::memcpy(p_header->magic, "DICEFRM1", 8);
+		std::strncpy(p_header->videoFilename, videoFilename.c_str(), sizeof(p_header->videoFilename));
+		p_header->width = static_cast<uint32_t>(firstFrame.cols);
+		p_header->height = static_cast<uint32_t>(firstFrame.rows);
+		p_header->type = firstFrame.type();
+		p_header->capacity = static_cast<uint32_t>(capacity);
+		p_header->frameOffset = frameOffset;
+		p_header->frameStride = frameStride;
+		p_header->fps = videoCapture.get(cv::CAP_PROP_FPS);
+		p_header->numVideoFrames = numVideoFrames;
+		cv::Mat frame0 = getFrame(0);
+		firstFrame.copyTo(frame0);
+		p_header->state.store(SharedFramesHeader::DECODING);
+		p_header->numFramesReady.store(1, std::memory_order_release);
+
+		decoder = std::thread(&SharedFrameServer::decode, this);
+#endif
+	}
+
+	SharedFrameServer(const SharedFrameServer&) = delete;
+	SharedFrameServer& operator=(const SharedFrameServer&) = delete;
+
+	~SharedFrameServer()
+	{
+		stopRequested = true;
+		if (decoder.joinable())
+			decoder.join();
+#if __unix__
+		if (p_header)
+		{
+			munmap(p_header, mappingSize);
+			shm_unlink(segmentName.c_str());
+		}
+#endif
+	}
+
+	bool isValid() const
+	{
+		return p_header != nullptr;
+	}
+
+	// Blocks until the decoder has stopped, i.e. all frames within the memory budget are in the segment (or decoding failed).
+	void waitUntilDecoded()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		decodedCondition.wait(lock, [&]() { return decoded; });
+	}
+
+	// Name of the segment, passed to the competitors through the environment variable DICE_SHARED_FRAMES.
+	const std::string& getSegmentName() const
+	{
+		return segmentName;
+	}
+
+private:
+	cv::Mat getFrame(uint frameNo)
+	{
+		uchar* p_frame = reinterpret_cast<uchar*>(p_header) + p_header->frameOffset + frameNo * p_header->frameStride;
+		return cv::Mat(static_cast<int>(p_header->height), static_cast<int>(p_header->width), p_header->type, p_frame);
+	}
+
+	void decode()
+	{
+#if __unix__
+		if (!decoderCpus.empty())
+			pinCurrentThreadToCpus(decoderCpus);
+#if __linux__
+		else
+		{
+			sched_param parameters = {};
+			sched_setscheduler(0, SCHED_IDLE, &parameters);
+		}
+#endif
+#endif
+
+		p_header->state.store(decodeFrames(), std::memory_order_release);
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded = true;
+		decodedCondition.notify_all();
+	}
+
+	SharedFramesHeader::State decodeFrames()
+	{
+		for (uint frameNo = 1; frameNo < p_header->capacity; ++frameNo)
+		{
+			if (stopRequested)
+				return SharedFramesHeader::FAILED;
+
+			if (!videoCapture.grab())
+				return SharedFramesHeader::END_OF_VIDEO;
+
+			// Usually decodes directly into the shared memory. A frame of a different size or type is not stored, the competitors decode it themselves.
+			cv::Mat frame = getFrame(frameNo);
+			uchar* p_frame = frame.data;
+			if (!videoCapture.retrieve(frame) || frame.size() != getFrame(frameNo).size() || frame.type() != p_header->type)
+				return SharedFramesHeader::FAILED;
+			if (frame.data != p_frame)
+			{
+				cv::Mat sharedFrame = getFrame(frameNo);
+				frame.copyTo(sharedFrame);
+			}
+
+			p_header->numFramesReady.store(frameNo + 1, std::memory_order_release);
+		}
+
+		return videoCapture.grab() ? SharedFramesHeader::CAPACITY_REACHED : SharedFramesHeader::END_OF_VIDEO;
+	}
+
+	const std::vector<uint> decoderCpus;
+	std::string segmentName;
+	SharedFramesHeader* p_header = nullptr;
+	size_t mappingSize = 0;
+	cv::VideoCapture videoCapture;
+	std::atomic<bool> stopRequested{ false };
+	bool decoded = false;
+	std::mutex mutex;
+	std::condition_variable decodedCondition;
+	std::thread decoder;
+};
+
+// Runs all (video, competitor) pairs on a pool of worker threads. Jobs are started in (video, competitor) order and the results are handed out in that order too, so the ranking and the CSV rows are deterministic no matter which job finishes first.
+// With persistent competitors, each worker keeps only the process of the competitor it ran last. So that it gets to reuse that process, the videos are started in batches, and within a batch in (competitor, video) order. A batch is a few videos per worker, which bounds the frame servers that are alive at the same time.
+class CompetitorScheduler
+{
+public:
+	// The result cache (optional) needs the content hashes of the videos and of their groundtruth.
+	CompetitorScheduler(const std::vector<Competitor>& competitors, const std::vector<std::string>& videoBasenames, const std::string& resultsDirectory, uint timeoutMs, const EvaluationOptions& options, const ResultCache* p_resultCache = nullptr, const std::vector<uint64_t>& videoHashes = {}, const std::vector<uint64_t>& groundtruthHashes = {})
+		: competitors(competitors), videoBasenames(videoBasenames), resultsDirectory(resultsDirectory), timeoutMs(timeoutMs), options(options), p_resultCache(p_resultCache), videoHashes(videoHashes), groundtruthHashes(groundtruthHashes), runs(competitors.size() * videoBasenames.size()), runDone(runs.size(), false), frameServers(videoBasenames.size()), frameServerOnceFlags(videoBasenames.size()), numUnfinishedJobs(videoBasenames.size(), competitors.size())
+	{
+		uint numCpus = std::max(1u, std::thread::hardware_concurrency());
+		uint numWorkers = options.numWorkers == 0 ? numCpus : options.numWorkers;
+		numWorkers = std::max(1u, std::min(numWorkers, static_cast<uint>(runs.size())));
+		numBatchVideos = options.persistentCompetitors ? numWorkers * NUM_BATCH_VIDEOS_PER_WORKER : 1;
+
+		// The frame servers decode on the CPUs that no worker is pinned to (none = idle priority).
+		std::vector<bool> workerCpus(numCpus, false);
+		for (uint i = 0; i < numWorkers; ++i)
+			for (uint cpuNo : getProcessLimits(options, i).cpus)
+				workerCpus[cpuNo] = true;
+		if (std::find(workerCpus.begin(), workerCpus.end(), true) != workerCpus.end())
+			for (uint cpuNo = 0; cpuNo < numCpus; ++cpuNo)
+				if (!workerCpus[cpuNo])
+					decoderCpus.push_back(cpuNo);
+
+		for (uint i = 0; i < numWorkers; ++i)
+			workers.emplace_back(&CompetitorScheduler::workerMain, this, i);
+	}
+
+	~CompetitorScheduler()
+	{
+		stopRequested = true;
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	uint getNumWorkers() const
+	{
+		return static_cast<uint>(workers.size());
+	}
+
+	// Blocks until the given pair has been run.
+	const CompetitorRun& waitFor(size_t videoNo, size_t competitorNo)
+	{
+		size_t jobNo = videoNo * competitors.size() + competitorNo;
+		std::unique_lock<std::mutex> lock(mutex);
+		runDoneCondition.wait(lock, [&]() { return runDone[jobNo]; });
+		return runs[jobNo];
+	}
+
+private:
+	// Videos per worker in a batch of the persistent-competitor order (see the class comment).
+	enum { NUM_BATCH_VIDEOS_PER_WORKER = 4 };
+
+	// Job number (the index in (video, competitor) order) of the given position in the start order.
+	size_t getJobNo(size_t startNo) const
+	{
+		size_t numBatchJobs = numBatchVideos * competitors.size();
+		size_t batchNo = startNo / numBatchJobs;
+		size_t firstVideoNo = batchNo * numBatchVideos;
+		size_t numVideos = std::min(numBatchVideos, videoBasenames.size() - firstVideoNo);
+		size_t batchJobNo = startNo - batchNo * numBatchJobs;
+		size_t videoNo = firstVideoNo + batchJobNo % numVideos;
+		size_t competitorNo = batchJobNo / numVideos;
+		return videoNo * competitors.size() + competitorNo;
+	}
+
+	void workerMain(uint workerNo)
+	{
+		ProcessLimits limits = getProcessLimits(options, workerNo);
+		if (!limits.cpus.empty() && !pinCurrentThreadToCpus(limits.cpus))
+			std::cerr << "Failed to pin worker thread " << workerNo << " to its CPU(s)!" << std::endl;
+
+#if __unix__
+		// Each worker has its own persistent competitor process, as the limits differ between the workers. It is stopped when the worker moves on to another competitor, and exits when the worker is done.
+		std::unique_ptr<PersistentCompetitorProcess> p_persistentProcess;
+		size_t persistentCompetitorNo = 0;
+#endif
+
+		while (!stopRequested)
+		{
+			size_t startNo = nextStartNo++;
+			if (startNo >= runs.size())
+				break;
+
+			CompetitorRun run;
+			size_t jobNo = getJobNo(startNo);
+			size_t competitorNo = jobNo % competitors.size();
+			const Competitor& competitor = competitors[competitorNo];
+			size_t videoNo = jobNo / competitors.size();
+			const std::string& videoBasename = videoBasenames[videoNo];
+
+			// Benchmarks always run, they need fresh timings.
+			bool useResultCache = p_resultCache && options.numBenchmarkRuns == 0;
+			uint64_t cacheKey = useResultCache ? ResultCache::makeKey(competitor.executableHash, videoHashes[videoNo], groundtruthHashes[videoNo], describeResourcePolicy(options)) : 0;
+			if (useResultCache && p_resultCache->load(cacheKey, run))
+			{
+				if (run.gotResult)
+				{
+					std::ofstream detectionResultFile(getDetectionResultFilename(resultsDirectory, videoBasename, competitor.name));
+					writeDetectionResult(detectionResultFile, run.detectionResult);
+				}
+				finishJob(jobNo, run);
+				continue;
+			}
+
+			// The decoding is not charged to any competitor. Meanwhile the next video gets decoded too, so that its first job rarely waits.
+			std::shared_ptr<SharedFrameServer> p_frameServer = acquireFrameServer(videoNo);
+			if (videoNo + 1 < videoBasenames.size())
+				acquireFrameServer(videoNo + 1);
+			if (p_frameServer)
+				p_frameServer->waitUntilDecoded();
+			uint numRuns = options.numBenchmarkRuns == 0 ? 1 : options.numWarmupRuns + options.numBenchmarkRuns;
+			for (uint i = 0; i < numRuns && !stopRequested; ++i)
+			{
+				if (options.coldCache && !evictFileFromPageCache(videoBasename + ".avi") && !coldCacheWarningShown.exchange(true))
+					std::cerr << "Failed to evict \"" << videoBasename << ".avi\" from the page cache, the cold-cache benchmark is not supported here!" << std::endl;
+
+				// The result of the last run is the one that gets scored.
+				std::unique_ptr<PersistentCompetitorProcess>* pp_persistentProcess = nullptr;
+#if __unix__
+				if (options.persistentCompetitors && !competitor.p_plugin)
+				{
+					if (competitorNo != persistentCompetitorNo)
+						p_persistentProcess.reset();
+					persistentCompetitorNo = competitorNo;
+					pp_persistentProcess = &p_persistentProcess;
+				}
+#endif
+				run.gotResult = callCompetitor(competitor, videoBasename, resultsDirectory, timeoutMs, limits, p_frameServer ? p_frameServer->getSegmentName() : std::string(), run.detectionResult, run.statistics, pp_persistentProcess);
+				bool succeeded = run.gotResult && !run.statistics.timedOut && run.statistics.exitCode == 0 && run.statistics.terminationSignal == 0;
+				if (options.numBenchmarkRuns != 0 && i >= options.numWarmupRuns)
+				{
+					if (succeeded)
+						run.latenciesMs.push_back(run.statistics.wallTimeMs);
+					else
+						++run.numFailedRuns;
+				}
+			}
+
+			if (useResultCache && !stopRequested)
+				p_resultCache->store(cacheKey, run);
+			finishJob(jobNo, run);
+		}
+	}
+
+	// Started by the first job of the video (or of the previous video) that actually runs a competitor (null if shared frames are off or unavailable, or if all jobs of the video have finished already).
+	std::shared_ptr<SharedFrameServer> acquireFrameServer(size_t videoNo)
+	{
+		if (options.sharedFramesBudgetMb == 0)
+			return nullptr;
+
+		std::call_once(frameServerOnceFlags[videoNo], [&]()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (numUnfinishedJobs[videoNo] == 0)
+					return;
+			}
+
+			auto p_frameServer = std::make_shared<SharedFrameServer>(videoBasenames[videoNo] + ".avi", static_cast<size_t>(options.sharedFramesBudgetMb) << 20, decoderCpus);
+			if (!p_frameServer->isValid())
+			{
+				if (!sharedFramesWarningShown.exchange(true))
+					std::cerr << "Failed to decode \"" << videoBasenames[videoNo] << ".avi\" into shared memory, the competitors decode the video themselves!" << std::endl;
+				return;
+			}
+
+			// The jobs of a prefetched video may have finished in the meantime (e.g. from the result cache), then the server is not kept.
+			std::lock_guard<std::mutex> lock(mutex);
+			if (numUnfinishedJobs[videoNo] != 0)
+				frameServers[videoNo] = p_frameServer;
+		});
+		std::lock_guard<std::mutex> lock(mutex);
+		return frameServers[videoNo];
+	}
+
+	void finishJob(size_t jobNo, const CompetitorRun& run)
+	{
+		// The frame server is destroyed after the last job of its video, outside of the lock.
+		std::shared_ptr<SharedFrameServer> p_finishedFrameServer;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			runs[jobNo] = run;
+			runDone[jobNo] = true;
+			size_t videoNo = jobNo / competitors.size();
+			if (--numUnfinishedJobs[videoNo] == 0)
+				p_finishedFrameServer = std::move(frameServers[videoNo]);
+			runDoneCondition.notify_all();
+		}
+	}
+
+	const std::vector<Competitor> competitors;
+	const std::vector<std::string> videoBasenames;
+	const std::string resultsDirectory;
+	const uint timeoutMs;
+	const EvaluationOptions options;
+	const ResultCache* p_resultCache;
+	const std::vector<uint64_t> videoHashes;
+	const std::vector<uint64_t> groundtruthHashes;
+	std::vector<CompetitorRun> runs;
+	std::vector<bool> runDone;
+	size_t numBatchVideos = 1;
+	std::vector<uint> decoderCpus;
+	std::atomic<size_t> nextStartNo{ 0 };
+	std::atomic<bool> stopRequested{ false };
+	std::atomic<bool> coldCacheWarningShown{ false };
+	std::atomic<bool> sharedFramesWarningShown{ false };
+	std::vector<std::shared_ptr<SharedFrameServer>> frameServers;
+	std::vector<std::once_flag> frameServerOnceFlags;
+	std::vector<size_t> numUnfinishedJobs;
+	std::mutex mutex;
+	std::condition_variable runDoneCondition;
+	std::vector<std::thread> workers;
+};
+
+// Decoded frames of one evaluation video, fetched by frame number. Frames are kept in a bounded LRU cache that is shared by all competitors, so each distinct frame number is decoded at most once (one keyframe-to-target decode after a seek).
+// OpenCV does not expose the keyframe positions, so the index records what can be observed: the exact frame count (once a sequential pass reached the end), the frame size and the decoder position. Frames shortly after the decoder position are reached by grabbing forward instead of seeking.
+class VideoFrameCache
+{
+public:
+	VideoFrameCache(const std::string& videoFilename, size_t capacity)
+		: videoCapture(videoFilename), capacity(std::max<size_t>(1, capacity))
+	{
+		if (!videoCapture.isOpened())
+			return;
+		numFrames = static_cast<uint>(videoCapture.get(cv::CAP_PROP_FRAME_COUNT));
+		frameSize = cv::Size(static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+	}
+
+	bool isOpened() const
+	{
+		return videoCapture.isOpened();
+	}
+
+	uint getNumFrames() const
+	{
+		return numFrames;
+	}
+
+	cv::Size getFrameSize() const
+	{
+		return frameSize;
+	}
+
+	uint getNumDecodedFrames() const
+	{
+		return numDecodedFrames;
+	}
+
+	uint getNumSeeks() const
+	{
+		return numSeeks;
+	}
+
+	// Sequential reading (for the preview). The frame is decoded into the caller's buffer and not cached; use put() for frames that will be needed again.
+	bool readNext(cv::Mat3b& outFrame, uint& outFrameNo)
+	{
+		outFrameNo = decoderPosition;
+		videoCapture >> outFrame;
+		if (outFrame.empty())
+		{
+			numFrames = decoderPosition;
+			frameCountExact = true;
+			return false;
+		}
+
+		++decoderPosition;
+		++numDecodedFrames;
+		frameSize = outFrame.size();
+		return true;
+	}
+
+	void put(uint frameNo, const cv::Mat3b& frame)
+	{
+		auto it = cacheIndex.find(frameNo);
+		if (it != cacheIndex.end())
+			cacheEntries.erase(it->second);
+		cacheEntries.emplace_front(frameNo, frame);
+		cacheIndex[frameNo] = cacheEntries.begin();
+		if (cacheEntries.size() > capacity)
+		{
+			cacheIndex.erase(cacheEntries.back().first);
+			cacheEntries.pop_back();
+		}
+	}
+
+	// Returns an empty frame if the frame number is out of range. The returned frame is shared with the cache and must not be modified.
+	cv::Mat3b get(uint frameNo)
+	{
+		auto it = cacheIndex.find(frameNo);
+		if (it != cacheIndex.end())
+		{
+			cacheEntries.splice(cacheEntries.begin(), cacheEntries, it->second);
+			return it->second->second;
+		}
+
+		if (frameCountExact && frameNo >= numFrames)
+			return cv::Mat3b();
+
+		if (frameNo < decoderPosition || frameNo - decoderPosition > MAX_FORWARD_GRABS)
+		{
+			videoCapture.set(cv::CAP_PROP_POS_FRAMES, frameNo);
+			decoderPosition = frameNo;
+			++numSeeks;
+		}
+
+		for (; decoderPosition < frameNo; ++decoderPosition)
+		{
+			if (!videoCapture.grab())
+				return cv::Mat3b();
+			++numDecodedFrames;
+		}
+
+		cv::Mat3b frame;
+		videoCapture >> frame;
+		if (frame.empty())
+			return frame;
+
+		++decoderPosition;
+		++numDecodedFrames;
+		put(frameNo, frame);
+		return frame;
+	}
+
+private:
+	static const uint MAX_FORWARD_GRABS = 50;
+
+	cv::VideoCapture videoCapture;
+	size_t capacity;
+	uint numFrames = 0;
+	bool frameCountExact = false;
+	cv::Size frameSize;
+	uint decoderPosition = 0;
+	uint numDecodedFrames = 0;
+	uint numSeeks = 0;
+	std::list<std::pair<uint, cv::Mat3b>> cacheEntries;
+	std::unordered_map<uint, std::list<std::pair<uint, cv::Mat3b>>::iterator> cacheIndex;
+};
+
+int computeScore(const DetectionResult& detectionResult, const Groundtruth& groundtruth, std::vector<bool>& outCompletelyWrong, std::vector<bool>& outHitByAnyDetection, std::vector<bool>& outClassifiedCorrectly)
+{
+	size_t numDetectedDice = detectionResult.detectedDice.size();
+	size_t numGroundtruthDice = groundtruth.groundtruthDice.size();
+	outCompletelyWrong.assign(detectionResult.detectedDice.size(), true);
+	outHitByAnyDetection.assign(numGroundtruthDice, false);
+	outClassifiedCorrectly.assign(numGroundtruthDice, false);
+	
+	for (size_t i = 0; i < numDetectedDice; ++i)
+	{
+		const DetectedDie& detectedDie = detectionResult.detectedDice[i];
+		for (size_t j = 0; j < numGroundtruthDice; ++j)
+		{
+			const GroundtruthDie& groundtruthDie = groundtruth.groundtruthDice[j];
+			if (cv::pointPolygonTest(groundtruthDie.contourPoints, detectedDie.somePositionWithin, false) >= 0)
+			{
+				outCompletelyWrong[i] = false;
+				outHitByAnyDetection[j] = true;
+				if (detectedDie.value == groundtruthDie.value)
+					outClassifiedCorrectly[j] = true;
+			}
+		}
+	}
+
+	return 2 * static_cast<int>(std::count(outHitByAnyDetection.begin(), outHitByAnyDetection.end(), true)) + static_cast<int>(std::count(outClassifiedCorrectly.begin(), outClassifiedCorrectly.end(), true)) - static_cast<int>(detectionResult.detectedDice.size());
+}
+
+// Rasterized form of a Groundtruth at frame resolution, so that scoring a detection needs a single lookup instead of a polygon test per die.
+// Pixels covered by more than one die, pixels close to a contour (where the polygon fill and cv::pointPolygonTest might disagree) and points outside the frame fall back to the exact test, restricted to the dice whose bounding box contains the point.
+struct GroundtruthLabelMap
+{
+	enum : ushort { NO_DIE = 0, AMBIGUOUS = 0xFFFF };
+
+	// NO_DIE, AMBIGUOUS or the die index + 1.
+	cv::Mat1w labels;
+	std::vector<cv::Rect> boundingBoxes;
+};
+
+GroundtruthLabelMap rasterizeGroundtruth(const Groundtruth& groundtruth, const cv::Size& frameSize)
+{
+	if (groundtruth.groundtruthDice.size() >= GroundtruthLabelMap::AMBIGUOUS)
+		throw std::runtime_error("Too many groundtruth dice to rasterize!");
+
+	GroundtruthLabelMap labelMap;
+	labelMap.labels = cv::Mat1w(frameSize, static_cast<ushort>(GroundtruthLabelMap::NO_DIE));
+	cv::Rect frameRect(cv::Point(0, 0), frameSize);
+	cv::Mat1b dieMask;
+	for (size_t j = 0; j < groundtruth.groundtruthDice.size(); ++j)
+	{
+		const GroundtruthDie& groundtruthDie = groundtruth.groundtruthDice[j];
+		const cv::Rect& boundingBox = groundtruthDie.boundingBox;
+		labelMap.boundingBoxes.push_back(boundingBox);
+		cv::Rect roi = boundingBox & frameRect;
+		if (roi.empty())
+			continue;
+
+		dieMask.create(roi.size());
+		dieMask.setTo(0);
+		cv::fillPoly(dieMask, std::vector<std::vector<cv::Point>>{ groundtruthDie.contourPoints }, cv::Scalar(255), cv::LINE_8, 0, -roi.tl());
+		cv::Mat1w labelsRoi = labelMap.labels(roi);
+		for (int y = 0; y < roi.height; ++y)
+		{
+			const uchar* p_mask = dieMask[y];
+			ushort* p_labels = labelsRoi[y];
+			for (int x = 0; x < roi.width; ++x)
+				if (p_mask[x])
+					p_labels[x] = p_labels[x] == GroundtruthLabelMap::NO_DIE ? static_cast<ushort>(j + 1) : static_cast<ushort>(GroundtruthLabelMap::AMBIGUOUS);
+		}
+	}
+
+	for (const GroundtruthDie& groundtruthDie : groundtruth.groundtruthDice)
+		cv::polylines(labelMap.labels, groundtruthDie.contourPoints, true, cv::Scalar(GroundtruthLabelMap::AMBIGUOUS), 5, cv::LINE_8);
+
+	return labelMap;
+}
+
+// Calls callback(j) for each groundtruth die j that contains the point (same semantics as cv::pointPolygonTest(...) >= 0).
+template <typename Callback> void forEachGroundtruthDieAt(const Groundtruth& groundtruth, const GroundtruthLabelMap& labelMap, const cv::Point& point, Callback callback)
+{
+	if (point.x >= 0 && point.y >= 0 && point.x < labelMap.labels.cols && point.y < labelMap.labels.rows)
+	{
+		ushort label = labelMap.labels(point);
+		if (label == GroundtruthLabelMap::NO_DIE)
+			return;
+		else if (label != GroundtruthLabelMap::AMBIGUOUS)
+		{
+			callback(static_cast<size_t>(label - 1));
+			return;
+		}
+	}
+
+	for (size_t j = 0; j < groundtruth.groundtruthDice.size(); ++j)
+		if (labelMap.boundingBoxes[j].contains(point) && cv::pointPolygonTest(groundtruth.groundtruthDice[j].contourPoints, point, false) >= 0)
+			callback(j);
+}
+
+// Same result as computeScore, using the label map.
+int computeScoreRasterized(const DetectionResult& detectionResult, const Groundtruth& groundtruth, const GroundtruthLabelMap& labelMap, std::vector<bool>& outCompletelyWrong, std::vector<bool>& outHitByAnyDetection, std::vector<bool>& outClassifiedCorrectly)
+{
+	size_t numDetectedDice = detectionResult.detectedDice.size();
+	size_t numGroundtruthDice = groundtruth.groundtruthDice.size();
+	outCompletelyWrong.assign(numDetectedDice, true);
+	outHitByAnyDetection.assign(numGroundtruthDice, false);
+	outClassifiedCorrectly.assign(numGroundtruthDice, false);
+
+	for (size_t i = 0; i < numDetectedDice; ++i)
+	{
+		const DetectedDie& detectedDie = detectionResult.detectedDice[i];
+		forEachGroundtruthDieAt(groundtruth, labelMap, detectedDie.somePositionWithin, [&](size_t j)
+		{
+			outCompletelyWrong[i] = false;
+			outHitByAnyDetection[j] = true;
+			if (detectedDie.value == groundtruth.groundtruthDice[j].value)
+				outClassifiedCorrectly[j] = true;
+		});
+	}
+
+	return 2 * static_cast<int>(std::count(outHitByAnyDetection.begin(), outHitByAnyDetection.end(), true)) + static_cast<int>(std::count(outClassifiedCorrectly.begin(), outClassifiedCorrectly.end(), true)) - static_cast<int>(numDetectedDice);
+}
+
+// Self-check: compares the label map lookup against cv::pointPolygonTest for every pixel in (and slightly around) the bounding boxes of all dice. Returns the number of mismatching pixels.
+size_t verifyGroundtruthLabelMap(const Groundtruth& groundtruth, const GroundtruthLabelMap& labelMap)
+{
+	size_t numMismatches = 0;
+	std::vector<size_t> expectedHits;
+	std::vector<size_t> actualHits;
+	for (const cv::Rect& boundingBox : labelMap.boundingBoxes)
+	{
+		for (int y = boundingBox.y - 2; y < boundingBox.y + boundingBox.height + 2; ++y)
+		{
+			for (int x = boundingBox.x - 2; x < boundingBox.x + boundingBox.width + 2; ++x)
+			{
+				cv::Point point(x, y);
+				expectedHits.clear();
+				for (size_t j = 0; j < groundtruth.groundtruthDice.size(); ++j)
+					if (cv::pointPolygonTest(groundtruth.groundtruthDice[j].contourPoints, point, false) >= 0)
+						expectedHits.push_back(j);
+				actualHits.clear();
+				forEachGroundtruthDieAt(groundtruth, labelMap, point, [&](size_t j) { actualHits.push_back(j); });
+				if (actualHits != expectedHits)
+					++numMismatches;
+			}
+		}
+	}
+
+	return numMismatches;
+}
+
+struct ScoredDetection
+{
+	bool gotResult = false;
+	DetectionResult detectionResult;
+	int score = 0;
+	std::vector<bool> completelyWrong;
+	std::vector<bool> hitByAnyDetection;
+	std::vector<bool> classifiedCorrectly;
+};
+
+int scoreDetection(const Groundtruth& groundtruth, const GroundtruthLabelMap& labelMap, ScoredDetection& scoredDetection)
+{
+	scoredDetection.score = computeScoreRasterized(scoredDetection.detectionResult, groundtruth, labelMap, scoredDetection.completelyWrong, scoredDetection.hitByAnyDetection, scoredDetection.classifiedCorrectly);
+	return scoredDetection.score;
+}
+
+bool agreesWithReferenceScore(const Groundtruth& groundtruth, const ScoredDetection& scoredDetection)
+{
+	std::vector<bool> completelyWrong;
+	std::vector<bool> hitByAnyDetection;
+	std::vector<bool> classifiedCorrectly;
+	int score = computeScore(scoredDetection.detectionResult, groundtruth, completelyWrong, hitByAnyDetection, classifiedCorrectly);
+	return score == scoredDetection.score && completelyWrong == scoredDetection.completelyWrong && hitByAnyDetection == scoredDetection.hitByAnyDetection && classifiedCorrectly == scoredDetection.classifiedCorrectly;
+}
+
+// Smallest frame size that contains all groundtruth dice (sufficient for the label map when no video frame is at hand, since points outside the map fall back to the exact test).
+cv::Size getGroundtruthExtent(const Groundtruth& groundtruth)
+{
+	cv::Size extent(1, 1);
+	for (const GroundtruthDie& groundtruthDie : groundtruth.groundtruthDice)
+	{
+		const cv::Rect& boundingBox = groundtruthDie.boundingBox;
+		extent.width = std::max(extent.width, boundingBox.x + boundingBox.width);
+		extent.height = std::max(extent.height, boundingBox.y + boundingBox.height);
+	}
+
+	return extent;
+}
+
+// Blends the competitor's reference frame (red if there is none) with the groundtruth reference frame and draws the groundtruth contours, the detections and the headline.
+// With a frame pool, the overlay takes its memory from the pool. The blending writes straight into the overlay, without the temporaries of matrix expressions.
+cv::Mat3b renderResultOverlay(const std::string& headline, const cv::Mat3b& groundtruthReferenceFrame, const cv::Mat3b& detectionReferenceFrame, const Groundtruth& groundtruth, const ScoredDetection& scoredDetection, FramePool* p_framePool = nullptr)
+{
+	cv::Mat3b frame;
+	if (p_framePool != nullptr)
+		p_framePool->attach(frame);
+	if (scoredDetection.gotResult && !detectionReferenceFrame.empty())
+		cv::addWeighted(detectionReferenceFrame, 0.5, groundtruthReferenceFrame, 0.5, 0.0, frame);
+	else
+	{
+		groundtruthReferenceFrame.convertTo(frame, -1, 0.5);
+		cv::add(frame, cv::Scalar(0, 0, 127.5), frame);
+	}
+
+	cv::Point labelPosition(20, 75);
+	frame.rowRange(0, 120) *= 0.25;
+	putTextShadow(frame, headline, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
+
+	if (!scoredDetection.gotResult)
+		return frame;
+
+	for (size_t k = 0; k < groundtruth.groundtruthDice.size(); ++k)
+	{
+		const GroundtruthDie& groundtruthDie = groundtruth.groundtruthDice[k];
+		cv::Scalar labelColor = cv::Scalar(0, 0, 255);
+		if (scoredDetection.classifiedCorrectly[k])
+			labelColor = cv::Scalar(0, 255, 0);
+		else if (scoredDetection.hitByAnyDetection[k])
+			labelColor = cv::Scalar(0, 255, 255);
+		cv::polylines(frame, groundtruthDie.contourPoints, true, cv::Scalar(0, 0, 0), 5, cv::LINE_AA);
+		cv::polylines(frame, groundtruthDie.contourPoints, true, labelColor, 2, cv::LINE_AA);
+		std::string label = std::to_string(groundtruthDie.value);
+		cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 1.75, 10, nullptr);
+		labelPosition = cv::Point(static_cast<int>(groundtruthDie.centroid.x), static_cast<int>(groundtruthDie.centroid.y)) + cv::Point(-labelSize.width / 2, labelSize.height / 2);
+		cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(0, 0, 0), 10, cv::LINE_AA);
+		cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, labelColor, 3, cv::LINE_AA);
+	}
+
+	const DetectionResult& detectionResult = scoredDetection.detectionResult;
+	for (size_t k = 0; k < detectionResult.detectedDice.size(); ++k)
+	{
+		const DetectedDie& detectedDie = detectionResult.detectedDice[k];
+		cv::Scalar labelColor = scoredDetection.completelyWrong[k] ? cv::Scalar(0, 0, 255) : cv::Scalar(255, 255, 255);
+		cv::drawMarker(frame, detectedDie.somePositionWithin, cv::Scalar(0, 0, 0), cv::MARKER_CROSS, 40, 5, cv::LINE_AA);
+		cv::drawMarker(frame, detectedDie.somePositionWithin, labelColor, cv::MARKER_CROSS, 40, 2, cv::LINE_AA);
+		std::string label = std::to_string(detectedDie.value);
+		labelPosition = detectedDie.somePositionWithin + cv::Point(10, -10);
+		putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1, labelColor, cv::Scalar(0, 0, 0), 2, 5, cv::LINE_AA);
+	}
+
+	return frame;
+}
+
+void updateRankingWindow(const std::string& windowName, const cv::Size& frameSize, std::vector<Competitor>& competitors, int currentVideoNo, size_t numVideos, int currentCompetitorNo, uint maximumScore, uint maximumTotalScore)
+{
+	cv::Mat3b frame(frameSize, cv::Vec3b(0, 0, 0));
+	std::string label = (currentVideoNo == -1) ? ("Final scores (max. " + std::to_string(maximumTotalScore) + " points in total)") : ("Scores - evaluation video " + std::to_string(currentVideoNo + 1) + " out of " + std::to_string(numVideos) + " (max. " + std::to_string(maximumScore) + " points)");
+	cv::Point labelPosition(20, 75);
+	frame.rowRange(0, 120).setTo(64);
+	putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
+	labelPosition.y += 110;
+	
+	std::vector<Competitor*> sortedCompetitors;
+	for (Competitor& competitor : competitors)
+		sortedCompetitors.push_back(&competitor);
+	std::sort(sortedCompetitors.begin(), sortedCompetitors.end(), [&](Competitor* p_x, Competitor* p_y) { return p_x->totalScore > p_y->totalScore; });
+	uint rank = 1;
+	uint numCompetitorsWithThisScore = 1;
+	for (size_t i = 0; i < sortedCompetitors.size(); ++i)
+	{
+		Competitor& competitor = *sortedCompetitors[i];
+		competitor.currentRank = rank;
+		if (i != sortedCompetitors.size() - 1 && competitor.totalScore == sortedCompetitors[i + 1]->totalScore)
+			++numCompetitorsWithThisScore;
+		else
+		{
+			rank += numCompetitorsWithThisScore;
+			numCompetitorsWithThisScore = 1;
+		}
+	}
+	
+	for (size_t i = 0; i < competitors.size(); ++i)
+	{
+		const Competitor& competitor = competitors[i];
+		label = '#' + std::to_string(competitor.currentRank) + " - \"" + competitor.name + "\": " + std::to_string(competitor.totalScore);
+		cv::Scalar labelColor;
+		if (currentVideoNo == -1)
+			labelColor = cv::Scalar(255, 255, 255);
+		else if (competitor.numVideosTested == currentVideoNo + 1)
+			labelColor = cv::Scalar(255, 255, 255);
+		else
+			labelColor = i == currentCompetitorNo ? cv::Scalar(255, 128, 0) : cv::Scalar(128, 128, 128);
+		if (competitor.currentVideoDone)
+			label += std::string(" (") + (competitor.currentVideoScore > 0 ? "+" : "") + std::to_string(competitor.currentVideoScore) + ')';
+
+		cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, labelColor, 3, cv::LINE_AA);
+		
+		if (competitor.totalScore > 0)
+		{
+			int full = static_cast<int>((frameSize.width - 2 * labelPosition.x) * competitor.totalScore / maximumTotalScore);
+			int part = static_cast<int>((frameSize.width - 2 * labelPosition.x) * competitor.currentVideoScore / maximumTotalScore);
+			if (currentVideoNo == -1)
+				part = full;
+			if (full - part > 0)
+				cv::rectangle(frame, cv::Rect(labelPosition.x, labelPosition.y + 20, full - part, 10), 0.5 * labelColor, -1);
+			if (part > 0)
+				cv::rectangle(frame, cv::Rect(labelPosition.x + full - part, labelPosition.y + 20, part, 10), labelColor, -1);
+		}
+		
+		labelPosition.y += 70;
+	}
+
+	cv::imshow(windowName, frame);
+}
+
+// Appends a file to an (uncompressed) ustar archive that standard tools can extract. The name must be shorter than 100 characters.
+void appendTarEntry(std::ostream& archive, const std::string& name, const std::vector<uchar>& data)
+{
+	char header[512] = {};
+	std::strncpy(header, name.c_str(), 99);
+	std::snprintf(header + 100, 8, "%07o", 0644);
+	std::snprintf(header + 108, 8, "%07o", 0);
+	std::snprintf(header + 116, 8, "%07o", 0);
+	std::snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(data.size()));
+	std::snprintf(header + 136, 12, "%011llo", static_cast<unsigned long long>(time(0)));
+	header[156] = '0';
+	std::memcpy(header + 257, "ustar", 6);
+	std::memcpy(header + 263, "00", 2);
+
+	// The checksum is computed with the checksum field itself filled with spaces.
+	std::memset(header + 148, ' ', 8);
+	uint checksum = 0;
+	for (char c : header)
+		checksum += static_cast<uchar>(c);
+	std::snprintf(header + 148, 7, "%06o", checksum);
+
+	archive.write(header, sizeof(header));
+	archive.write(reinterpret_cast<const char*>(data.data()), data.size());
+	const char padding[512] = {};
+	archive.write(padding, (512 - data.size() % 512) % 512);
+}
+
+// Renders, encodes and writes the overlay images on a small pool of background threads, so that PNG encoding never delays the scoring of the next competitor.
+// The queue is bounded: submit() blocks while it is full, so a slow disk cannot pile up frames in memory.
+class OverlayWriter
+{
+public:
+	// Scale < 1 writes the overlays at reduced resolution. The archive ("Overlays.tar" in the directory) stores JPEG images instead of one PNG file per overlay. Verbose prints the statistics of the frame pool when done.
+	OverlayWriter(const std::string& directory, uint numThreads, double scale, bool archive, bool verbose = false)
+		: directory(directory), scale(scale), verbose(verbose), maxQueueSize(2 * std::max(1u, numThreads))
+	{
+		if (archive)
+			archiveFile.open(directory + "/Overlays.tar", std::ios::binary);
+		for (uint i = 0; i < std::max(1u, numThreads); ++i)
+			threads.emplace_back(&OverlayWriter::threadMain, this);
+	}
+
+	OverlayWriter(const OverlayWriter&) = delete;
+	OverlayWriter& operator=(const OverlayWriter&) = delete;
+
+	// Writes all remaining overlays.
+	~OverlayWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finishRequested = true;
+		}
+		queueCondition.notify_all();
+		for (std::thread& thread : threads)
+			thread.join();
+		if (verbose)
+			framePool.printStatistics(std::cout);
+
+		if (archiveFile.is_open())
+		{
+			const char endOfArchive[1024] = {};
+			archiveFile.write(endOfArchive, sizeof(endOfArchive));
+		}
+	}
+
+	// Overlays rendered into frames of this pool recycle the memory of the overlays already written. They must not outlive the writer.
+	FramePool& getFramePool()
+	{
+		return framePool;
+	}
+
+	// The name is the filename without extension. The render function is called on a background thread and must only use data that outlives the writer.
+	void submit(const std::string& name, const std::function<cv::Mat3b()>& render)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		spaceCondition.wait(lock, [&]() { return queue.size() < maxQueueSize; });
+		queue.push_back({ name, render });
+		queueCondition.notify_one();
+	}
+
+private:
+	struct Job
+	{
+		std::string name;
+		std::function<cv::Mat3b()> render;
+	};
+
+	void threadMain()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [&]() { return !queue.empty() || finishRequested; });
+				if (queue.empty())
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			spaceCondition.notify_one();
+
+			if (!write(job.name, job.render()))
+				std::cerr << "Failed to write the overlay image \"" << job.name << "\"!" << std::endl;
+		}
+	}
+
+	bool write(const std::string& name, const cv::Mat3b& overlay)
+	{
+		cv::Mat3b scaledOverlay = overlay;
+		if (scale < 1)
+		{
+			scaledOverlay = cv::Mat3b();
+			framePool.attach(scaledOverlay);
+			cv::resize(overlay, scaledOverlay, cv::Size(), scale, scale, cv::INTER_AREA);
+		}
+
+		if (!archiveFile.is_open())
+			return cv::imwrite(directory + '/' + name + ".png", scaledOverlay);
+
+		std::vector<uchar> encodedOverlay;
+		std::string entryName = name + ".jpg";
+		if (entryName.size() > 99 || !cv::imencode(".jpg", scaledOverlay, encodedOverlay, { cv::IMWRITE_JPEG_QUALITY, 90 }))
+			return false;
+
+		std::lock_guard<std::mutex> lock(archiveMutex);
+		appendTarEntry(archiveFile, entryName, encodedOverlay);
+		return static_cast<bool>(archiveFile);
+	}
+
+	// Declared first, so it is destroyed after everything that might still hold one of its frames.
+	FramePool framePool{ "overlays" };
+	const std::string directory;
+	const double scale;
+	const bool verbose;
+	const size_t maxQueueSize;
+	std::deque<Job> queue;
+	bool finishRequested = false;
+	std::mutex mutex;
+	std::condition_variable queueCondition;
+	std::condition_variable spaceCondition;
+	std::ofstream archiveFile;
+	std::mutex archiveMutex;
+	std::vector<std::thread> threads;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	bool open(const std::string& filename)
+	{
+		close();
+#if _WIN32
+		fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+			return false;
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mappingHandle)
+			return false;
+		p_data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!p_data)
+			return false;
+		size = static_cast<size_t>(fileSize.QuadPart);
+#elif __unix__
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd == -1)
+			return false;
+		struct stat fileStatus;
+		if (fstat(fd, &fileStatus) != 0 || fileStatus.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+		void* p_mapping = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (p_mapping == MAP_FAILED)
+			return false;
+		p_data = static_cast<const char*>(p_mapping);
+		size = static_cast<size_t>(fileStatus.st_size);
+#endif
+		return true;
+	}
+
+	void close()
+	{
+#if _WIN32
+		if (p_data)
+			UnmapViewOfFile(p_data);
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		if (fileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(fileHandle);
+		mappingHandle = nullptr;
+		fileHandle = INVALID_HANDLE_VALUE;
+#elif __unix__
+		if (p_data)
+			munmap(const_cast<char*>(p_data), size);
+#endif
+		p_data = nullptr;
+		size = 0;
+	}
+
+	const char* getData() const
+	{
+		return p_data;
+	}
+
+	size_t getSize() const
+	{
+		return size;
+	}
+
+private:
+	const char* p_data = nullptr;
+	size_t size = 0;
+#if _WIN32
+	HANDLE fileHandle = INVALID_HANDLE_VALUE;
+	HANDLE mappingHandle = nullptr;
+#endif
+};
+
+// All groundtruth of an evaluation data directory, compiled into one binary file that is memory-mapped instead of parsing the JSON files.
+// Layout (native byte order, it is a cache and not meant to be moved between machines): header, entries, dice, contour points, strings (JSON paths relative to the evaluation data directory).
+// Each entry records the size, modification time and hash of its JSON file. An entry whose JSON file changed is stale and gets ignored.
+class GroundtruthStore
+{
+public:
+	static void compile(const std::string& evaluationDataDirectory, const std::vector<std::pair<std::string, Groundtruth>>& evaluationData, const std::string& filename)
+	{
+		std::vector<StoreEntry> entries;
+		std::vector<StoreDie> dice;
+		std::vector<StorePoint> points;
+		std::string strings;
+		for (const auto& evaluationItem : evaluationData)
+		{
+			std::string jsonFilename = evaluationItem.first + ".json";
+			std::string relativePath = getRelativePath(evaluationDataDirectory, jsonFilename);
+			StoreEntry entry;
+			entry.pathOffset = strings.size();
+			entry.pathLength = static_cast<uint32_t>(relativePath.size());
+			strings += relativePath;
+			entry.referenceFrameNo = evaluationItem.second.referenceFrameNo;
+			entry.sourceSize = static_cast<uint64_t>(fs::file_size(jsonFilename));
+			entry.sourceModificationTime = static_cast<int64_t>(fs::last_write_time(jsonFilename).time_since_epoch().count());
+			entry.sourceHash = hashFile(jsonFilename);
+			entry.firstDie = static_cast<uint32_t>(dice.size());
+			entry.numDice = static_cast<uint32_t>(evaluationItem.second.groundtruthDice.size());
+			entries.push_back(entry);
+
+			for (const GroundtruthDie& groundtruthDie : evaluationItem.second.groundtruthDice)
+			{
+				StoreDie die;
+				die.firstPoint = static_cast<uint32_t>(points.size());
+				die.numPoints = static_cast<uint32_t>(groundtruthDie.contourPoints.size());
+				die.value = groundtruthDie.value;
+				die.reserved = 0;
+				die.boundingBox[0] = groundtruthDie.boundingBox.x;
+				die.boundingBox[1] = groundtruthDie.boundingBox.y;
+				die.boundingBox[2] = groundtruthDie.boundingBox.width;
+				die.boundingBox[3] = groundtruthDie.boundingBox.height;
+				cv::Moments contourMoments = cv::moments(groundtruthDie.contourPoints);
+				die.m00 = contourMoments.m00;
+				die.m10 = contourMoments.m10;
+				die.m01 = contourMoments.m01;
+				dice.push_back(die);
+				for (const cv::Point& point : groundtruthDie.contourPoints)
+					points.push_back({ point.x, point.y });
+			}
+		}
+
+		StoreHeader header;
+		std::memcpy(header.magic, getMagic(), sizeof(header.magic));
+		header.version = VERSION;
+		header.numEntries = static_cast<uint32_t>(entries.size());
+		header.entriesOffset = sizeof(StoreHeader);
+		header.diceOffset = header.entriesOffset + entries.size() * sizeof(StoreEntry);
+		header.pointsOffset = header.diceOffset + dice.size() * sizeof(StoreDie);
+		header.stringsOffset = header.pointsOffset + points.size() * sizeof(StorePoint);
+		header.fileSize = header.stringsOffset + strings.size();
+
+		// Another evaluation may have the store mapped, so it is replaced by renaming instead of being overwritten.
+		std::string temporaryFilename = getTemporaryFilename(filename);
+		{
+			std::ofstream file(temporaryFilename, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(StoreEntry));
+			file.write(reinterpret_cast<const char*>(dice.data()), dice.size() * sizeof(StoreDie));
+			file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(StorePoint));
+			file.write(strings.data(), strings.size());
+			if (!file)
+			{
+				file.close();
+				fs::remove(temporaryFilename);
+				throw std::runtime_error("Failed to open/create/write groundtruth store \"" + filename + "\"!");
+			}
+		}
+
+		try
+		{
+			fs::rename(temporaryFilename, filename);
+		}
+		catch (const std::exception&)
+		{
+			fs::remove(temporaryFilename);
+			throw std::runtime_error("Failed to replace groundtruth store \"" + filename + "\"!");
+		}
+	}
+
+	bool open(const std::string& filename)
+	{
+		index.clear();
+		if (!mappedFile.open(filename) || mappedFile.getSize() < sizeof(StoreHeader))
+			return false;
+
+		const StoreHeader& header = *reinterpret_cast<const StoreHeader*>(mappedFile.getData());
+		if (std::memcmp(header.magic, getMagic(), sizeof(header.magic)) != 0 || header.version != VERSION || header.fileSize != mappedFile.getSize())
+			return false;
+
+		// A truncated or corrupt store must not lead to reads outside of the mapping. The sections follow each other in the order of the layout.
+		uint64_t fileSize = mappedFile.getSize();
+		if (header.entriesOffset != sizeof(StoreHeader) || header.diceOffset - header.entriesOffset != static_cast<uint64_t>(header.numEntries) * sizeof(StoreEntry) || header.diceOffset > header.pointsOffset || header.pointsOffset > header.stringsOffset || header.stringsOffset > fileSize || (header.pointsOffset - header.diceOffset) % sizeof(StoreDie) != 0 || (header.stringsOffset - header.pointsOffset) % sizeof(StorePoint) != 0)
+			return fail();
+		uint64_t numDice = (header.pointsOffset - header.diceOffset) / sizeof(StoreDie);
+		uint64_t numPoints = (header.stringsOffset - header.pointsOffset) / sizeof(StorePoint);
+		uint64_t stringsSize = fileSize - header.stringsOffset;
+
+		p_entries = reinterpret_cast<const StoreEntry*>(mappedFile.getData() + header.entriesOffset);
+		p_dice = reinterpret_cast<const StoreDie*>(mappedFile.getData() + header.diceOffset);
+		p_points = reinterpret_cast<const StorePoint*>(mappedFile.getData() + header.pointsOffset);
+		p_strings = mappedFile.getData() + header.stringsOffset;
+		for (uint64_t i = 0; i < numDice; ++i)
+			if (static_cast<uint64_t>(p_dice[i].firstPoint) + p_dice[i].numPoints > numPoints)
+				return fail();
+		for (uint32_t i = 0; i < header.numEntries; ++i)
+		{
+			const StoreEntry& entry = p_entries[i];
+			if (entry.pathOffset > stringsSize || entry.pathLength > stringsSize - entry.pathOffset || static_cast<uint64_t>(entry.firstDie) + entry.numDice > numDice)
+				return fail();
+			index.emplace(std::string(p_strings + entry.pathOffset, entry.pathLength), &entry);
+		}
+
+		return true;
+	}
+
+	size_t getNumEntries() const
+	{
+		return index.size();
+	}
+
+	// Returns false if there is no entry for the JSON file or if the JSON file changed since the store was compiled.
+	bool lookup(const std::string& evaluationDataDirectory, const std::string& jsonFilename, Groundtruth& outGroundtruth) const
+	{
+		auto it = index.find(getRelativePath(evaluationDataDirectory, jsonFilename));
+		if (it == index.end())
+			return false;
+
+		// Size and modification time unchanged: trust the entry without reading the JSON file. Otherwise the content hash decides.
+		const StoreEntry& entry = *it->second;
+		if (static_cast<uint64_t>(fs::file_size(jsonFilename)) != entry.sourceSize || static_cast<int64_t>(fs::last_write_time(jsonFilename).time_since_epoch().count()) != entry.sourceModificationTime)
+			if (hashFile(jsonFilename) != entry.sourceHash)
+				return false;
+
+		outGroundtruth.referenceFrameNo = entry.referenceFrameNo;
+		outGroundtruth.groundtruthDice.resize(entry.numDice);
+		for (uint32_t j = 0; j < entry.numDice; ++j)
+		{
+			const StoreDie& die = p_dice[entry.firstDie + j];
+			GroundtruthDie& groundtruthDie = outGroundtruth.groundtruthDice[j];
+			groundtruthDie.value = die.value;
+			groundtruthDie.contourPoints.resize(die.numPoints);
+			for (uint32_t k = 0; k < die.numPoints; ++k)
+				groundtruthDie.contourPoints[k] = cv::Point(p_points[die.firstPoint + k].x, p_points[die.firstPoint + k].y);
+			groundtruthDie.boundingBox = cv::Rect(die.boundingBox[0], die.boundingBox[1], die.boundingBox[2], die.boundingBox[3]);
+			cv::Moments contourMoments;
+			contourMoments.m00 = die.m00;
+			contourMoments.m10 = die.m10;
+			contourMoments.m01 = die.m01;
+			groundtruthDie.centroid = getCentroid(contourMoments, groundtruthDie.boundingBox);
+		}
+
+		return true;
+	}
+
+private:
+	static const uint32_t VERSION = 1;
+
+	static const char* getMagic()
+	{
+		return "DICEGT\0\0";
+	}
+
+	struct StoreHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t numEntries;
+		uint64_t entriesOffset;
+		uint64_t diceOffset;
+		uint64_t pointsOffset;
+		uint64_t stringsOffset;
+		uint64_t fileSize;
+	};
+
+	struct StoreEntry
+	{
+		uint64_t pathOffset;
+		uint32_t pathLength;
+		uint32_t referenceFrameNo;
+		uint64_t sourceSize;
+		int64_t sourceModificationTime;
+		uint64_t sourceHash;
+		uint32_t firstDie;
+		uint32_t numDice;
+	};
+
+	struct StoreDie
+	{
+		uint32_t firstPoint;
+		uint32_t numPoints;
+		uint32_t value;
+		uint32_t reserved;
+		int32_t boundingBox[4];
+		double m00;
+		double m10;
+		double m01;
+	};
+
+	struct StorePoint
+	{
+		int32_t x;
+		int32_t y;
+	};
+
+	static_assert(sizeof(StoreHeader) == 56 && sizeof(StoreEntry) == 48 && sizeof(StoreDie) == 56 && sizeof(StorePoint) == 8, "Unexpected groundtruth store record layout!");
+
+	bool fail()
+	{
+		index.clear();
+		mappedFile.close();
+		return false;
+	}
+
+	static std::string getRelativePath(const std::string& directory, const std::string& filename)
+	{
+		std::string relativePath = filename.compare(0, directory.size(), directory) == 0 ? filename.substr(directory.size()) : filename;
+		relativePath.erase(0, relativePath.find_first_not_of("/\\"));
+		std::replace(relativePath.begin(), relativePath.end(), '\\', '/');
+		return relativePath;
+	}
+
+	MappedFile mappedFile;
+	const StoreEntry* p_entries = nullptr;
+	const StoreDie* p_dice = nullptr;
+	const StorePoint* p_points = nullptr;
+	const char* p_strings = nullptr;
+	std::unordered_map<std::string, const StoreEntry*> index;
+};
+
+bool loadEvaluationData(const std::string& evaluationDataDirectory, const GroundtruthStore* p_groundtruthStore, std::vector<std::pair<std::string, Groundtruth>>& outEvaluationData)
+{
+	size_t numLoadedFromStore = 0;
+	for (const auto& directoryEntry : fs::recursive_directory_iterator(evaluationDataDirectory))
+	{
+		const auto& path = directoryEntry.path();
+		if (fs::is_regular_file(directoryEntry) && path.extension() == ".avi")
+		{
+			auto pngPath = path;
+			pngPath.replace_extension(".png");
+			auto jsonPath = path;
+			jsonPath.replace_extension(".json");
+			if (!fs::is_regular_file(pngPath) || !fs::is_regular_file(jsonPath))
+			{
+				std::cerr << "Missing reference frame and/or JSON file for the video file \"" << path.string() << "\"!" << std::endl;
+				return false;
+			}
+
+			auto pathWithoutExtension = path;
+			pathWithoutExtension.replace_extension();
+			Groundtruth groundtruth;
+			if (p_groundtruthStore && p_groundtruthStore->lookup(evaluationDataDirectory, jsonPath.string(), groundtruth))
+				++numLoadedFromStore;
+			else
+			{
+				if (p_groundtruthStore)
+					std::cout << "The groundtruth store has no up-to-date entry for \"" << jsonPath.string() << "\", parsing the JSON file." << std::endl;
+				groundtruth = loadGroundtruth(jsonPath.string());
+			}
+			outEvaluationData.emplace_back(pathWithoutExtension.string(), groundtruth);
+			if (!p_groundtruthStore)
+				std::cout << "Added evaluation video \"" << path.string() << "\"." << std::endl;
+		}
+	}
+
+	if (outEvaluationData.empty())
+	{
+		std::cerr << "No evaluation data found in directory \"" << evaluationDataDirectory << "\". Put some data there!" << std::endl;
+		return false;
+	}
+
+	if (p_groundtruthStore)
+		std::cout << "Took the groundtruth of " << numLoadedFromStore << " out of " << outEvaluationData.size() << " evaluation videos from the groundtruth store." << std::endl;
+	std::cout << "We have " << outEvaluationData.size() << " evaluation videos." << std::endl;
+	return true;
+}
+
+// Re-scores the detection result files stored in an existing results directory against the (possibly updated) groundtruth, without running any competitor. Regenerates "Results.csv" and, optionally, the overlay images.
+int rescoreResults(const EvaluationOptions& options, const GroundtruthStore* p_groundtruthStore, const std::string& resultsDirectory, const std::string& evaluationDataDirectory)
+{
+	std::vector<std::string> competitorNames;
+	{
+		std::ifstream csvFile(resultsDirectory + "/Results.csv");
+		std::string header;
+		if (!std::getline(csvFile, header))
+		{
+			std::cerr << "Failed to read the competitor names from \"" << resultsDirectory << "/Results.csv\"!" << std::endl;
+			return 1;
+		}
+
+		// The names cannot contain commas (see main), so the header needs no CSV quoting.
+		std::istringstream headerStream(header);
+		std::string name;
+		std::getline(headerStream, name, ',');
+		while (std::getline(headerStream, name, ','))
+			competitorNames.push_back(name);
+	}
+
+	std::cout << "Re-scoring the results of " << competitorNames.size() << " competitors in \"" << resultsDirectory << "\"." << std::endl;
+
+	std::vector<std::pair<std::string, Groundtruth>> evaluationData;
+	if (!loadEvaluationData(evaluationDataDirectory, p_groundtruthStore, evaluationData))
+		return 1;
+
+	std::vector<std::vector<int>> scores(evaluationData.size(), std::vector<int>(competitorNames.size(), 0));
+	std::atomic<size_t> nextVideoNo{ 0 };
+	std::atomic<size_t> numErrors{ 0 };
+	std::atomic<size_t> numFailedVideos{ 0 };
+	std::mutex outputMutex;
+	auto rescoreVideos = [&]()
+	{
+		for (size_t i = nextVideoNo++; i < evaluationData.size(); i = nextVideoNo++)
+		{
+			const std::string& videoBasename = evaluationData[i].first;
+			const Groundtruth& groundtruth = evaluationData[i].second;
+			std::string videoName = fs::path(videoBasename).filename().string();
+			uint maximumScore = 2 * static_cast<uint>(groundtruth.groundtruthDice.size());
+			try
+			{
+				std::unique_ptr<VideoFrameCache> p_frameCache;
+				cv::Mat3b groundtruthReferenceFrame;
+				if (options.rescoreOverlays)
+				{
+					p_frameCache = std::make_unique<VideoFrameCache>(videoBasename + ".avi", options.frameCacheCapacity);
+					groundtruthReferenceFrame = p_frameCache->get(groundtruth.referenceFrameNo);
+					if (groundtruthReferenceFrame.empty())
+						throw std::runtime_error("Failed to read the reference frame #" + std::to_string(groundtruth.referenceFrameNo) + " of video file \"" + videoBasename + ".avi\"!");
+				}
+
+				GroundtruthLabelMap labelMap = rasterizeGroundtruth(groundtruth, groundtruthReferenceFrame.empty() ? getGroundtruthExtent(groundtruth) : groundtruthReferenceFrame.size());
+				if (options.scoreSelfCheck)
+					numErrors += verifyGroundtruthLabelMap(groundtruth, labelMap);
+
+				for (size_t j = 0; j < competitorNames.size(); ++j)
+				{
+					ScoredDetection scoredDetection;
+					std::string detectionResultFilename = getDetectionResultFilename(resultsDirectory, videoBasename, competitorNames[j]);
+					if (fs::is_regular_file(detectionResultFilename))
+					{
+						try
+						{
+							scoredDetection.detectionResult = loadDetectionResult(detectionResultFilename);
+							scoredDetection.gotResult = true;
+						}
+						catch (const std::exception&)
+						{
+						}
+					}
+
+					if (scoredDetection.gotResult)
+					{
+						scores[i][j] = scoreDetection(groundtruth, labelMap, scoredDetection);
+						if (options.scoreSelfCheck && !agreesWithReferenceScore(groundtruth, scoredDetection))
+							++numErrors;
+					}
+
+					if (options.rescoreOverlays)
+					{
+						std::string label = scoredDetection.gotResult ? ('"' + competitorNames[j] + "\" (re-scored): " + std::to_string(scores[i][j]) + " points out of " + std::to_string(maximumScore)) : ('"' + competitorNames[j] + "\" gave no result: 0 points out of " + std::to_string(maximumScore));
+						cv::Mat3b detectionReferenceFrame = scoredDetection.gotResult ? p_frameCache->get(scoredDetection.detectionResult.referenceFrameNo) : cv::Mat3b();
+						cv::imwrite(resultsDirectory + '/' + videoName + " - " + competitorNames[j] + ".png", renderResultOverlay(label, groundtruthReferenceFrame, detectionReferenceFrame, groundtruth, scoredDetection));
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(outputMutex);
+				std::cout << "Re-scored evaluation video \"" << videoName << "\"." << std::endl;
+			}
+			catch (const std::exception& exception)
+			{
+				++numErrors;
+				++numFailedVideos;
+				std::lock_guard<std::mutex> lock(outputMutex);
+				std::cerr << "Failed to re-score evaluation video \"" << videoName << "\": " << exception.what() << std::endl;
+			}
+		}
+	};
+
+	uint numWorkers = options.numWorkers == 0 ? std::max(1u, std::thread::hardware_concurrency()) : options.numWorkers;
+	std::vector<std::thread> workers;
+	for (uint i = 0; i < std::min(numWorkers, static_cast<uint>(evaluationData.size())); ++i)
+		workers.emplace_back(rescoreVideos);
+	for (std::thread& worker : workers)
+		worker.join();
+
+	// The previous results are only replaced by complete new ones.
+	std::string csvFilename = resultsDirectory + "/Results.csv";
+	std::string temporaryCsvFilename = getTemporaryFilename(csvFilename);
+	std::ofstream csvFile(temporaryCsvFilename);
+	for (const std::string& competitorName : competitorNames)
+		csvFile << ',' << competitorName;
+	csvFile << std::endl;
+	std::vector<int> totalScores(competitorNames.size(), 0);
+	uint maximumTotalScore = 0;
+	for (size_t i = 0; i < evaluationData.size(); ++i)
+	{
+		csvFile << fs::path(evaluationData[i].first).filename().string();
+		for (size_t j = 0; j < competitorNames.size(); ++j)
+		{
+			csvFile << ',' << scores[i][j];
+			totalScores[j] += scores[i][j];
+		}
+		csvFile << std::endl;
+		maximumTotalScore += 2 * static_cast<uint>(evaluationData[i].second.groundtruthDice.size());
+	}
+	csvFile << "Total";
+	for (int totalScore : totalScores)
+		csvFile << ';' << totalScore;
+	csvFile.close();
 
-	try
+	bool replaced = false;
+	if (csvFile && numFailedVideos == 0)
 	{
-		outDetectionResult = loadDetectionResult(detectionResultFilename);
+		try
+		{
+			fs::rename(temporaryCsvFilename, csvFilename);
+			replaced = true;
+		}
+		catch (const std::exception&)
+		{
+		}
 	}
-	catch (const std::exception&)
+	if (!replaced)
 	{
-		return false;
+		fs::remove(temporaryCsvFilename);
+		std::cerr << "Kept the previous \"" << csvFilename << "\", " << (numFailedVideos != 0 ? std::to_string(numFailedVideos) + " video(s) could not be re-scored!" : "failed to write the new one!") << std::endl;
+		++numErrors;
 	}
 
-	return true;
-}
+	std::cout << std::endl;
+	std::cout << "Final scores (max. " << maximumTotalScore << " points):" << std::endl;
+	for (size_t j = 0; j < competitorNames.size(); ++j)
+		std::cout << "- " << competitorNames[j] << ": " << totalScores[j] << " points" << std::endl;
 
-int computeScore(const DetectionResult& detectionResult, const Groundtruth& groundtruth, std::vector<bool>& outCompletelyWrong, std::vector<bool>& outHitByAnyDetection, std::vector<bool>& outClassifiedCorrectly)
-{
-	size_t numDetectedDice = detectionResult.detectedDice.size();
-	size_t numGroundtruthDice = groundtruth.groundtruthDice.size();
-	outCompletelyWrong.assign(detectionResult.detectedDice.size(), true);
-	outHitByAnyDetection.assign(numGroundtruthDice, false);
-	outClassifiedCorrectly.assign(numGroundtruthDice, false);
-	
-	for (size_t i = 0; i < numDetectedDice; ++i)
+	if (numErrors != 0)
 	{
-		const DetectedDie& detectedDie = detectionResult.detectedDice[i];
-		for (size_t j = 0; j < numGroundtruthDice; ++j)
-		{
-			const GroundtruthDie& groundtruthDie = groundtruth.groundtruthDice[j];
-			if (cv::pointPolygonTest(groundtruthDie.contourPoints, detectedDie.somePositionWithin, false) >= 0)
-			{
-				outCompletelyWrong[i] = false;
-				outHitByAnyDetection[j] = true;
-				if (detectedDie.value == groundtruthDie.value)
-					outClassifiedCorrectly[j] = true;
-			}
-		}
+		std::cerr << "Re-scoring finished with " << numErrors << " error(s)/self-check mismatch(es)!" << std::endl;
+		return 1;
 	}
 
-	return 2 * static_cast<int>(std::count(outHitByAnyDetection.begin(), outHitByAnyDetection.end(), true)) + static_cast<int>(std::count(outClassifiedCorrectly.begin(), outClassifiedCorrectly.end(), true)) - static_cast<int>(detectionResult.detectedDice.size());
+	return 0;
 }
 
-void updateRankingWindow(const std::string& windowName, const cv::Size& frameSize, std::vector<Competitor>& competitors, int currentVideoNo, size_t numVideos, int currentCompetitorNo, uint maximumScore, uint maximumTotalScore)
+int main(int numArgs, const char** pp_args)
 {
-	cv::Mat3b frame(frameSize, cv::Vec3b(0, 0, 0));
-	std::string label = (currentVideoNo == -1) ? ("Final scores (max. " + std::to_string(maximumTotalScore) + " points in total)") : ("Scores - evaluation video " + std::to_string(currentVideoNo + 1) + " out of " + std::to_string(numVideos) + " (max. " + std::to_string(maximumScore) + " points)");
-	cv::Point labelPosition(20, 75);
-	frame.rowRange(0, 120).setTo(64);
-	putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
-	labelPosition.y += 110;
-	
-	std::vector<Competitor*> sortedCompetitors;
-	for (Competitor& competitor : competitors)
-		sortedCompetitors.push_back(&competitor);
-	std::sort(sortedCompetitors.begin(), sortedCompetitors.end(), [&](Competitor* p_x, Competitor* p_y) { return p_x->totalScore > p_y->totalScore; });
-	uint rank = 1;
-	uint numCompetitorsWithThisScore = 1;
-	for (size_t i = 0; i < sortedCompetitors.size(); ++i)
+#if __linux__
+	if (numArgs == 5 && pp_args[1] == PLUGIN_HOST_OPTION)
+		return runPluginHost(pp_args[2], pp_args[3], pp_args[4]);
+#endif
+
+	EvaluationOptions options;
+	bool numWorkersGiven = false;
+	int firstArg = 1;
+	for (; firstArg < numArgs && std::string(pp_args[firstArg]).compare(0, 2, "--") == 0; ++firstArg)
 	{
-		Competitor& competitor = *sortedCompetitors[i];
-		competitor.currentRank = rank;
-		if (i != sortedCompetitors.size() - 1 && competitor.totalScore == sortedCompetitors[i + 1]->totalScore)
-			++numCompetitorsWithThisScore;
+		std::string option = pp_args[firstArg];
+		if (option == "--headless")
+			options.headless = true;
+		else if (option == "--jobs" && firstArg + 1 < numArgs)
+		{
+			options.numWorkers = fromString<uint>(pp_args[++firstArg]);
+			numWorkersGiven = true;
+		}
+		else if (option == "--pin-cpus")
+			options.pinWorkers = true;
+		else if (option == "--benchmark" && firstArg + 1 < numArgs)
+			options.numBenchmarkRuns = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--warmup" && firstArg + 1 < numArgs)
+			options.numWarmupRuns = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--cold-cache")
+			options.coldCache = true;
+		else if (option == "--frame-cache" && firstArg + 1 < numArgs)
+			options.frameCacheCapacity = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--score-self-check")
+			options.scoreSelfCheck = true;
+		else if (option == "--rescore")
+			options.rescore = true;
+		else if (option == "--overlays")
+			options.rescoreOverlays = true;
+		else if (option == "--groundtruth-store" && firstArg + 1 < numArgs)
+			options.groundtruthStoreFilename = pp_args[++firstArg];
+		else if (option == "--compile-groundtruth")
+			options.compileGroundtruth = true;
+		else if (option == "--cache" && firstArg + 1 < numArgs)
+			options.resultCacheDirectory = pp_args[++firstArg];
+		else if (option == "--isolate-plugins")
+			options.isolatePlugins = true;
+		else if (option == "--shared-frames" && firstArg + 1 < numArgs)
+			options.sharedFramesBudgetMb = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--overlay-writers" && firstArg + 1 < numArgs)
+			options.numOverlayWriters = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--overlay-scale" && firstArg + 1 < numArgs)
+			options.overlayScale = fromString<double>(pp_args[++firstArg]);
+		else if (option == "--overlay-archive")
+			options.overlayArchive = true;
+		else if (option == "--cpu-limit" && firstArg + 1 < numArgs)
+			options.cpuLimit = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--memory-limit" && firstArg + 1 < numArgs)
+			options.memoryLimitMb = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--thread-limit" && firstArg + 1 < numArgs)
+			options.threadLimit = fromString<uint>(pp_args[++firstArg]);
+		else if (option == "--cgroup" && firstArg + 1 < numArgs)
+			options.cgroupDirectory = pp_args[++firstArg];
+		else if (option == "--persistent-competitors")
+			options.persistentCompetitors = true;
+		else if (option == "--verbose")
+			options.verbose = true;
 		else
 		{
-			rank += numCompetitorsWithThisScore;
-			numCompetitorsWithThisScore = 1;
+			std::cerr << "Unknown option \"" << option << "\"!" << std::endl;
+			return 1;
 		}
 	}
-	
-	for (size_t i = 0; i < competitors.size(); ++i)
+
+	if (options.compileGroundtruth)
 	{
-		const Competitor& competitor = competitors[i];
-		label = '#' + std::to_string(competitor.currentRank) + " - \"" + competitor.name + "\": " + std::to_string(competitor.totalScore);
-		cv::Scalar labelColor;
-		if (currentVideoNo == -1)
-			labelColor = cv::Scalar(255, 255, 255);
-		else if (competitor.numVideosTested == currentVideoNo + 1)
-			labelColor = cv::Scalar(255, 255, 255);
-		else
-			labelColor = i == currentCompetitorNo ? cv::Scalar(255, 128, 0) : cv::Scalar(128, 128, 128);
-		if (competitor.currentVideoDone)
-			label += std::string(" (") + (competitor.currentVideoScore > 0 ? "+" : "") + std::to_string(competitor.currentVideoScore) + ')';
+		if (numArgs - firstArg != 2)
+		{
+			std::cerr << "Invalid command line arguments: For compiling the groundtruth, specify \"--compile-groundtruth\" followed by the directory containing the evaluation data and the groundtruth store file to create!" << std::endl;
+			return 1;
+		}
 
-		cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, labelColor, 3, cv::LINE_AA);
-		
-		if (competitor.totalScore > 0)
+		std::vector<std::pair<std::string, Groundtruth>> evaluationData;
+		if (!loadEvaluationData(pp_args[firstArg], nullptr, evaluationData))
+			return 1;
+		GroundtruthStore::compile(pp_args[firstArg], evaluationData, pp_args[firstArg + 1]);
+		std::cout << "Compiled the groundtruth of " << evaluationData.size() << " evaluation videos into \"" << pp_args[firstArg + 1] << "\"." << std::endl;
+		return 0;
+	}
+
+	GroundtruthStore groundtruthStore;
+	const GroundtruthStore* p_groundtruthStore = nullptr;
+	if (!options.groundtruthStoreFilename.empty())
+	{
+		if (!groundtruthStore.open(options.groundtruthStoreFilename))
 		{
-			int full = static_cast<int>((frameSize.width - 2 * labelPosition.x) * competitor.totalScore / maximumTotalScore);
-			int part = static_cast<int>((frameSize.width - 2 * labelPosition.x) * competitor.currentVideoScore / maximumTotalScore);
-			if (currentVideoNo == -1)
-				part = full;
-			if (full - part > 0)
-				cv::rectangle(frame, cv::Rect(labelPosition.x, labelPosition.y + 20, full - part, 10), 0.5 * labelColor, -1);
-			if (part > 0)
-				cv::rectangle(frame, cv::Rect(labelPosition.x + full - part, labelPosition.y + 20, part, 10), labelColor, -1);
+			std::cerr << "Failed to open/read groundtruth store \"" << options.groundtruthStoreFilename << "\"! Create it using \"--compile-groundtruth\"." << std::endl;
+			return 1;
 		}
-		
-		labelPosition.y += 70;
+		p_groundtruthStore = &groundtruthStore;
+		std::cout << "Opened groundtruth store \"" << options.groundtruthStoreFilename << "\" with " << groundtruthStore.getNumEntries() << " entries." << std::endl;
 	}
 
-	cv::imshow(windowName, frame);
-}
+	if (options.rescore)
+	{
+		if (numArgs - firstArg != 2)
+		{
+			std::cerr << "Invalid command line arguments: For re-scoring, specify the options (\"--rescore\", optional \"--overlays\", \"--jobs <number>\", \"--score-self-check\", \"--groundtruth-store <file>\") followed by the existing results directory (containing \"Results.csv\") and the directory containing the evaluation data!" << std::endl;
+			return 1;
+		}
 
-int main(int numArgs, const char** pp_args)
-{
-	if (numArgs < 5 || numArgs % 2 != 1)
+		// Re-scoring is cheap per file, so use all cores unless told otherwise.
+		if (!numWorkersGiven)
+			options.numWorkers = 0;
+		return rescoreResults(options, p_groundtruthStore, pp_args[firstArg], pp_args[firstArg + 1]);
+	}
+
+	if (numArgs - firstArg < 4 || (numArgs - firstArg) % 2 != 0)
+	{
+		std::cerr << "Invalid command line arguments: Specify the options (optional, \"--headless\", \"--jobs <number>\", \"--pin-cpus\", \"--benchmark <runs>\", \"--warmup <runs>\", \"--cold-cache\", \"--frame-cache <frames>\", \"--score-self-check\"; \"--groundtruth-store <file>\", \"--cache <directory>\", \"--isolate-plugins\", \"--shared-frames <MiB>\", \"--overlay-writers <threads>\", \"--overlay-scale <factor>\", \"--overlay-archive\", \"--cpu-limit <cores>\", \"--memory-limit <MiB>\", \"--thread-limit <threads>\", \"--cgroup <directory>\", \"--persistent-competitors\", \"--verbose\"; \"--rescore\" re-scores an existing results directory and \"--compile-groundtruth\" creates a groundtruth store instead), the competitors (name and executable path for each one; a path ending with \".so\", \".dll\" or \".dylib\" is loaded as a competitor plugin) followed by the directory containing the evaluation data and the directory that will contain the output!" << std::endl;
+		return 1;
+	}
+
+#if _WIN32
+	if (options.memoryLimitMb != 0 || options.threadLimit != 0 || !options.cgroupDirectory.empty())
+		std::cerr << "Warning: Memory, thread and cgroup limits are not supported on Windows, only the CPU affinity is applied!" << std::endl;
+	if (options.persistentCompetitors)
 	{
-		std::cerr << "Invalid command line arguments: Specify the competitors (name and executable path for each one) followed by the directory containing the evaluation data and the directory that will contain the output!" << std::endl;
+		std::cerr << "Warning: Persistent competitors are not supported on Windows, the competitors are started for every video!" << std::endl;
+		options.persistentCompetitors = false;
+	}
+#elif __unix__
+	// A persistent competitor that died must not take the evaluation down when the next request is written to it.
+	if (options.persistentCompetitors)
+		signal(SIGPIPE, SIG_IGN);
+	if (!options.cgroupDirectory.empty() && !prepareCgroupDirectory(options.cgroupDirectory))
+	{
+		std::cerr << "Failed to enable the cpu, memory and pids controllers in \"" << options.cgroupDirectory << "\"! It must be a cgroup v2 directory that is delegated to this user and contains no processes." << std::endl;
 		return 1;
 	}
+	if (options.threadLimit != 0 && options.cgroupDirectory.empty())
+		std::cerr << "Warning: The thread limit is only enforced with \"--cgroup\"!" << std::endl;
+#endif
 
 	std::string videoWindowName = "Dice Detection Evaluation - Video";
-	cv::namedWindow(videoWindowName, cv::WINDOW_NORMAL);
-	cv::resizeWindow(videoWindowName, 1936, 1216);
-	
 	std::string rankingWindowName = "Dice Detection Evaluation - Ranking";
-	cv::namedWindow(rankingWindowName, cv::WINDOW_NORMAL);
 	cv::Size rankingFrameSize(1920, 1080);
-	cv::resizeWindow(rankingWindowName, rankingFrameSize.width, rankingFrameSize.height);
+	if (!options.headless)
+	{
+		cv::namedWindow(videoWindowName, cv::WINDOW_NORMAL);
+		cv::resizeWindow(videoWindowName, 1936, 1216);
+		cv::namedWindow(rankingWindowName, cv::WINDOW_NORMAL);
+		cv::resizeWindow(rankingWindowName, rankingFrameSize.width, rankingFrameSize.height);
+	}
 	
 	std::vector<Competitor> competitors;
-	for (int i = 1; i < numArgs - 2; i += 2)
+	for (int i = firstArg; i < numArgs - 2; i += 2)
 	{
 		Competitor competitor;
 		competitor.name = pp_args[i];
 		competitor.executablePath = pp_args[i + 1];
+		if (competitor.name.find_first_of(",\"\r\n") != std::string::npos)
+		{
+			std::cerr << "The competitor name \"" << competitor.name << "\" must not contain commas, quotes or line breaks, it is a column of the CSV files!" << std::endl;
+			return 1;
+		}
 		if (!fs::is_regular_file(competitor.executablePath))
 		{
 			std::cerr << "The provided executable path \"" << competitor.executablePath << "\" for competitor \"" << competitor.name << "\" is not a regular file!" << std::endl;
 			return 1;
 		}
 
+		if (CompetitorPlugin::isPluginFilename(competitor.executablePath))
+		{
+			try
+			{
+				competitor.p_plugin = std::make_shared<CompetitorPlugin>(fs::absolute(competitor.executablePath).string(), options.isolatePlugins);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+			if (options.isolatePlugins && !CompetitorPlugin::isIsolationSupported())
+				std::cerr << "Warning: Plugin isolation is only supported on Linux, competitor \"" << competitor.name << "\" runs in-process!" << std::endl;
+		}
+
 		competitors.push_back(competitor);
 		std::cout << "Added competitor \"" << competitor.name << "\" with executable path \"" << competitor.executablePath << "\"." << std::endl;
 	}
@@ -304,35 +3135,8 @@ int main(int numArgs, const char** pp_args)
 	std::cout << std::endl;
 
 	std::vector<std::pair<std::string, Groundtruth>> evaluationData;
-	for (const auto& directoryEntry : fs::recursive_directory_iterator(evaluationDataDirectory))
-	{
-		const auto& path = directoryEntry.path();
-		if (fs::is_regular_file(directoryEntry) && path.extension() == ".avi")
-		{
-			auto pngPath = path;
-			pngPath.replace_extension(".png");
-			auto jsonPath = path;
-			jsonPath.replace_extension(".json");
-			if (!fs::is_regular_file(pngPath) || !fs::is_regular_file(jsonPath))
-			{
-				std::cerr << "Missing reference frame and/or JSON file for the video file \"" << path.string() << "\"!" << std::endl;
-				return 1;
-			}
-
-			auto pathWithoutExtension = path;
-			pathWithoutExtension.replace_extension();
-			evaluationData.emplace_back(pathWithoutExtension.string(), loadGroundtruth(jsonPath.string()));
-			std::cout << "Added evaluation video \"" << path.string() << "\"." << std::endl;
-		}
-	}
-
-	if (evaluationData.empty())
-	{
-		std::cerr << "No evaluation data found in directory \"" << evaluationDataDirectory << "\". Put some data there!" << std::endl;
+	if (!loadEvaluationData(evaluationDataDirectory, p_groundtruthStore, evaluationData))
 		return 1;
-	}
-	
-	std::cout << "We have " << evaluationData.size() << " evaluation videos." << std::endl;
 
 	time_t now = time(0);
 	tm* p_timeStruct = localtime(&now);
@@ -345,17 +3149,61 @@ int main(int numArgs, const char** pp_args)
 	for (const Competitor& competitor : competitors)
 		csvFile << ',' << competitor.name;
 	csvFile << std::endl;
+	std::ofstream runsCsvFile(resultsDirectory + "/Runs.csv");
+	runsCsvFile << "Video,Competitor,Score,Wall time [ms],User time [ms],System time [ms],Peak RSS [KiB],Exit status,Resource policy" << std::endl;
+	std::string resourcePolicy = describeResourcePolicy(options);
+	std::cout << "Resource policy of the competitor runs: " << resourcePolicy << std::endl;
+	std::ofstream stagesCsvFile(resultsDirectory + "/Stages.csv");
+	stagesCsvFile << "Video,Competitor,Kind,Name,Value" << std::endl;
+	std::vector<StageBreakdown> stageBreakdowns(competitors.size());
+	std::unique_ptr<OverlayWriter> p_overlayWriter = std::make_unique<OverlayWriter>(resultsDirectory, options.numOverlayWriters, options.overlayScale, options.overlayArchive, options.verbose);
+	FramePool* p_overlayFramePool = &p_overlayWriter->getFramePool();
 
 	uint maximumTotalScore = 0;
 	for (const auto& evaluationItem : evaluationData)
 		maximumTotalScore += 2 * static_cast<uint>(evaluationItem.second.groundtruthDice.size());
 
+	std::vector<std::string> videoBasenames;
+	for (const auto& evaluationItem : evaluationData)
+		videoBasenames.push_back(evaluationItem.first);
+	std::unique_ptr<ResultCache> p_resultCache;
+	std::vector<uint64_t> videoHashes;
+	std::vector<uint64_t> groundtruthHashes;
+	if (!options.resultCacheDirectory.empty())
+	{
+		std::cout << "Hashing the competitors and evaluation videos for the result cache in \"" << options.resultCacheDirectory << "\" ..." << std::endl;
+		p_resultCache = std::make_unique<ResultCache>(options.resultCacheDirectory);
+		for (Competitor& competitor : competitors)
+			competitor.executableHash = p_resultCache->getFileHash(competitor.executablePath);
+		for (const auto& evaluationItem : evaluationData)
+		{
+			videoHashes.push_back(p_resultCache->getFileHash(evaluationItem.first + ".avi"));
+			groundtruthHashes.push_back(p_resultCache->getFileHash(evaluationItem.first + ".json"));
+		}
+	}
+
+	CompetitorScheduler scheduler(competitors, videoBasenames, resultsDirectory, 15000, options, p_resultCache.get(), videoHashes, groundtruthHashes);
+	std::cout << "Running the competitors on " << scheduler.getNumWorkers() << " worker(s)" << (options.pinWorkers ? ", pinned to individual CPUs" : "") << '.' << std::endl;
+
+	std::ofstream benchmarkCsvFile;
+	std::vector<std::vector<uint>> competitorLatenciesMs(competitors.size());
+	std::vector<uint> competitorNumFailedRuns(competitors.size(), 0);
+	if (options.numBenchmarkRuns != 0)
+	{
+		std::cout << "Benchmark mode: " << options.numBenchmarkRuns << " measured and " << options.numWarmupRuns << " warm-up run(s) per video" << (options.coldCache ? ", cold page cache" : "") << '.' << std::endl;
+		if (options.coldCache && scheduler.getNumWorkers() > 1)
+			std::cout << "Note: With several workers, concurrent runs on the same video may warm the page cache again." << std::endl;
+		benchmarkCsvFile.open(resultsDirectory + "/Benchmark.csv");
+		benchmarkCsvFile << "Video,Competitor,Runs,Failed runs,Min [ms],Median [ms],P95 [ms],Max [ms]" << std::endl;
+	}
+
+	size_t numScoreSelfCheckMismatches = 0;
 	for (size_t i = 0; i < evaluationData.size(); ++i)
 	{
 		const auto& evaluationItem = evaluationData[i];
 		std::string videoFilename = evaluationItem.first + ".avi";
-		cv::VideoCapture videoCapture(videoFilename);
-		if (!videoCapture.isOpened())
+		VideoFrameCache frameCache(videoFilename, options.frameCacheCapacity);
+		if (!frameCache.isOpened())
 		{
 			std::cerr << "Failed to open video file \"" << videoFilename << "\"!" << std::endl;
 			return 1;
@@ -368,20 +3216,21 @@ int main(int numArgs, const char** pp_args)
 		std::cout << std::endl;
 		std::cout << "Processing evaluation video \"" << videoFilename << "\" (" << evaluationItem.second.groundtruthDice.size() << " dice, max. " << maximumScore << " points) ..." << std::endl;
 
-		updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), -1, maximumScore, maximumTotalScore);
-		cv::waitKey(1);
-
 		cv::Mat3b frame;
-		cv::Size videoSize;
-		while (true)
+		cv::Size videoSize = frameCache.getFrameSize();
+		if (!options.headless)
+		{
+			updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), -1, maximumScore, maximumTotalScore);
+			cv::waitKey(1);
+		}
+
+		uint frameNo;
+		while (!options.headless && frameCache.readNext(frame, frameNo))
 		{
-			uint frameNo = static_cast<uint>(videoCapture.get(cv::CAP_PROP_POS_FRAMES));
-			videoCapture >> frame;
-			if (frame.empty())
-				break;
 			videoSize = frame.size();
 			if (frameNo == groundtruth.referenceFrameNo)
 			{
+				frameCache.put(frameNo, frame.clone());
 				for (const auto& groundtruthDie : groundtruth.groundtruthDice)
 					cv::fillPoly(frame, std::vector<std::vector<cv::Point>>{ groundtruthDie.contourPoints }, cv::Scalar(0, 0, 255), cv::LINE_AA);
 				frame *= 2;
@@ -397,113 +3246,121 @@ int main(int numArgs, const char** pp_args)
 		}
 
 		frame = cv::Mat3b::zeros(videoSize);
-		cv::imshow(videoWindowName, frame);
-		cv::waitKey(1);
+		if (!options.headless)
+		{
+			cv::imshow(videoWindowName, frame);
+			cv::waitKey(1);
+		}
+
+		cv::Mat3b groundtruthReferenceFrame = frameCache.get(groundtruth.referenceFrameNo);
+		if (groundtruthReferenceFrame.empty())
+		{
+			std::cerr << "Failed to read the reference frame #" << groundtruth.referenceFrameNo << " of video file \"" << videoFilename << "\"!" << std::endl;
+			return 1;
+		}
 
-		videoCapture.set(cv::CAP_PROP_POS_FRAMES, groundtruth.referenceFrameNo);
-		cv::Mat3b groundtruthReferenceFrame;
-		videoCapture >> groundtruthReferenceFrame;
+		GroundtruthLabelMap labelMap = rasterizeGroundtruth(groundtruth, groundtruthReferenceFrame.size());
+		if (options.scoreSelfCheck)
+		{
+			size_t numMismatches = verifyGroundtruthLabelMap(groundtruth, labelMap);
+			numScoreSelfCheckMismatches += numMismatches;
+			if (numMismatches != 0)
+				std::cerr << "Score self-check: The label map of \"" << videoFilename << "\" disagrees with the polygon test at " << numMismatches << " pixel(s)!" << std::endl;
+		}
 
 		for (size_t j = 0; j < competitors.size(); ++j)
 		{
 			Competitor& competitor = competitors[j];
 			std::cout << "- Testing competitor \"" << competitor.name << "\" ...";
 
-			frame.setTo(0);
-			cv::imshow(videoWindowName, frame);
-			cv::waitKey(250);
-
-			groundtruthReferenceFrame.copyTo(frame);
 			std::string label = "Testing \"" + competitor.name + "\" (" + std::to_string(j + 1) + " out of " + std::to_string(competitors.size()) + ") ...";
 			cv::Point labelPosition(20, 75);
-			frame.rowRange(0, 120) *= 0.25;
-			putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
-			cv::imshow(videoWindowName, frame);
-			updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), static_cast<int>(j), maximumScore, maximumTotalScore);
-			cv::waitKey(250);
-
-			DetectionResult detectionResult;
-			uint runningTime;
-			bool gotResult = callCompetitor(competitor, evaluationItem.first, resultsDirectory, 15000, detectionResult, runningTime);
-			if (gotResult)
+			if (!options.headless)
 			{
-				std::vector<bool> completelyWrong;
-				std::vector<bool> hitByAnyDetection;
-				std::vector<bool> classifiedCorrectly;
-				competitor.currentVideoScore = computeScore(detectionResult, groundtruth, completelyWrong, hitByAnyDetection, classifiedCorrectly);
+				frame.setTo(0);
+				cv::imshow(videoWindowName, frame);
+				cv::waitKey(250);
 
-				std::cout << " ref. frame #" << detectionResult.referenceFrameNo << ", " << detectionResult.detectedDice.size() << " dice detected, " << competitor.currentVideoScore << " points" << std::endl;
-
-				cv::Mat3b detectionReferenceFrame;
-				if (detectionResult.referenceFrameNo < static_cast<uint>(videoCapture.get(cv::CAP_PROP_FRAME_COUNT)))
-				{
-					videoCapture.set(cv::CAP_PROP_POS_FRAMES, detectionResult.referenceFrameNo);
-					videoCapture >> detectionReferenceFrame;
-				}
-				else
-					detectionReferenceFrame = cv::Mat3b(videoSize, cv::Vec3b(0, 0, 255));
-				frame = 0.5 * (detectionReferenceFrame + groundtruthReferenceFrame);
-
-				label = '"' + competitor.name + "\" finished in " + std::to_string(runningTime) + " ms: " + std::to_string(competitor.currentVideoScore) + " points out of " + std::to_string(maximumScore);
+				groundtruthReferenceFrame.copyTo(frame);
 				frame.rowRange(0, 120) *= 0.25;
 				putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
+				cv::imshow(videoWindowName, frame);
+				updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), static_cast<int>(j), maximumScore, maximumTotalScore);
+				cv::waitKey(250);
+			}
 
-				for (size_t k = 0; k < groundtruth.groundtruthDice.size(); ++k)
+			const CompetitorRun& run = scheduler.waitFor(i, j);
+			const DetectionResult& detectionResult = run.detectionResult;
+			uint runningTime = run.statistics.wallTimeMs;
+			bool gotResult = run.gotResult;
+			std::function<cv::Mat3b()> renderOverlay;
+			ScoredDetection scoredDetection;
+			scoredDetection.gotResult = gotResult;
+			if (gotResult)
+			{
+				scoredDetection.detectionResult = detectionResult;
+				competitor.currentVideoScore = scoreDetection(groundtruth, labelMap, scoredDetection);
+				if (options.scoreSelfCheck && !agreesWithReferenceScore(groundtruth, scoredDetection))
 				{
-					const GroundtruthDie& groundtruthDie = groundtruth.groundtruthDice[k];
-					cv::Scalar labelColor = cv::Scalar(0, 0, 255);
-					if (classifiedCorrectly[k])
-						labelColor = cv::Scalar(0, 255, 0);
-					else if (hitByAnyDetection[k])
-						labelColor = cv::Scalar(0, 255, 255);
-					cv::polylines(frame, groundtruthDie.contourPoints, true, cv::Scalar(0, 0, 0), 5, cv::LINE_AA);
-					cv::polylines(frame, groundtruthDie.contourPoints, true, labelColor, 2, cv::LINE_AA);
-					label = std::to_string(groundtruthDie.value);
-					cv::Size labelSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 1.75, 10, nullptr);
-					cv::Moments contourMoments = cv::moments(groundtruthDie.contourPoints);
-					labelPosition = cv::Point(static_cast<int>(contourMoments.m10 / contourMoments.m00), static_cast<int>(contourMoments.m01 / contourMoments.m00)) + cv::Point(-labelSize.width / 2, labelSize.height / 2);
-					cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(0, 0, 0), 10, cv::LINE_AA);
-					cv::putText(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, labelColor, 3, cv::LINE_AA);
+					++numScoreSelfCheckMismatches;
+					std::cerr << "Score self-check: Rasterized and polygon-test scoring disagree for competitor \"" << competitor.name << "\"!" << std::endl;
 				}
 
-				for (size_t k = 0; k < detectionResult.detectedDice.size(); ++k)
-				{
-					const DetectedDie& detectedDie = detectionResult.detectedDice[k];
-					cv::Scalar labelColor = completelyWrong[k] ? cv::Scalar(0, 0, 255) : cv::Scalar(255, 255, 255);
-					cv::drawMarker(frame, detectedDie.somePositionWithin, cv::Scalar(0, 0, 0), cv::MARKER_CROSS, 40, 5, cv::LINE_AA);
-					cv::drawMarker(frame, detectedDie.somePositionWithin, labelColor, cv::MARKER_CROSS, 40, 2, cv::LINE_AA);
-					label = std::to_string(detectedDie.value);
-					labelPosition = detectedDie.somePositionWithin + cv::Point(10, -10);
-					putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1, labelColor, cv::Scalar(0, 0, 0), 2, 5, cv::LINE_AA);
-				}
+				std::cout << (run.fromCache ? " (cached)" : "") << " ref. frame #" << detectionResult.referenceFrameNo << ", " << detectionResult.detectedDice.size() << " dice detected, " << competitor.currentVideoScore << " points (" << runningTime << " ms wall, " << run.statistics.userTimeMs + run.statistics.systemTimeMs << " ms CPU, " << run.statistics.peakRssKb / 1024 << " MiB peak RSS)" << std::endl;
+
+				label = '"' + competitor.name + "\" finished in " + std::to_string(runningTime) + " ms: " + std::to_string(competitor.currentVideoScore) + " points out of " + std::to_string(maximumScore);
+				cv::Mat3b detectionReferenceFrame = frameCache.get(detectionResult.referenceFrameNo);
+				renderOverlay = [=, &groundtruth]() { return renderResultOverlay(label, groundtruthReferenceFrame, detectionReferenceFrame, groundtruth, scoredDetection, p_overlayFramePool); };
 			}
 			else
 			{
 				competitor.currentVideoScore = 0;
 
-				std::cout << " No result! 0 points" << std::endl;
+				std::cout << (run.fromCache ? " (cached)" : "") << " No result! 0 points (exit status: " << describeExitStatus(run.statistics) << ')' << std::endl;
 
-				frame = 0.5 * (groundtruthReferenceFrame + cv::Mat3b(videoSize, cv::Vec3b(0, 0, 255)));
 				label = '"' + competitor.name + "\" gave no result: 0 points out of " + std::to_string(maximumScore);
-				frame.rowRange(0, 120) *= 0.25;
-				putTextShadow(frame, label, labelPosition, cv::FONT_HERSHEY_SIMPLEX, 1.75, cv::Scalar(255, 255, 255), cv::Scalar(0, 0, 0), 3, 10, cv::LINE_AA);
+				renderOverlay = [=, &groundtruth]() { return renderResultOverlay(label, groundtruthReferenceFrame, cv::Mat3b(), groundtruth, scoredDetection, p_overlayFramePool); };
 			}
 
 			competitor.currentVideoDone = true;
 
 			csvFile << ',' << competitor.currentVideoScore;
+			const RunStatistics& statistics = run.statistics;
+			runsCsvFile << fs::path(videoFilename).filename().replace_extension().string() << ',' << competitor.name << ',' << competitor.currentVideoScore << ',' << statistics.wallTimeMs << ',' << statistics.userTimeMs << ',' << statistics.systemTimeMs << ',' << statistics.peakRssKb << ',' << describeExitStatus(statistics) << ',' << resourcePolicy << std::endl;
+			if (gotResult)
+			{
+				for (const auto& stageTime : detectionResult.stageTimesMs)
+					stagesCsvFile << fs::path(videoFilename).filename().replace_extension().string() << ',' << competitor.name << ",stage," << stageTime.first << ',' << stageTime.second << std::endl;
+				for (const auto& counter : detectionResult.counters)
+					stagesCsvFile << fs::path(videoFilename).filename().replace_extension().string() << ',' << competitor.name << ",counter," << counter.first << ',' << counter.second << std::endl;
+				addToStageBreakdown(detectionResult, runningTime, stageBreakdowns[j]);
+			}
+			if (benchmarkCsvFile.is_open())
+			{
+				LatencySummary summary = summarizeLatencies(run.latenciesMs);
+				benchmarkCsvFile << fs::path(videoFilename).filename().replace_extension().string() << ',' << competitor.name << ',' << run.latenciesMs.size() << ',' << run.numFailedRuns << ',' << summary.minMs << ',' << summary.medianMs << ',' << summary.p95Ms << ',' << summary.maxMs << std::endl;
+				competitorLatenciesMs[j].insert(competitorLatenciesMs[j].end(), run.latenciesMs.begin(), run.latenciesMs.end());
+				competitorNumFailedRuns[j] += run.numFailedRuns;
+			}
 			competitor.totalScore += competitor.currentVideoScore;
 
-			std::string detectionResultFilename = resultsDirectory + '/' + fs::path(evaluationItem.first).filename().string() + " - " + competitor.name + ".png";
-			cv::imwrite(detectionResultFilename, frame);
-
-			cv::imshow(videoWindowName, frame);
-			updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), static_cast<int>(j), maximumScore, maximumTotalScore);
-			cv::waitKey(gotResult ? 3000 : 1000);
+			// Without windows the overlay is rendered in the background too. Otherwise it is needed here for display and only written in the background.
+			std::string overlayName = fs::path(evaluationItem.first).filename().string() + " - " + competitor.name;
+			if (options.headless)
+				p_overlayWriter->submit(overlayName, renderOverlay);
+			else
+			{
+				cv::Mat3b overlay = renderOverlay();
+				p_overlayWriter->submit(overlayName, [overlay]() { return overlay; });
+				cv::imshow(videoWindowName, overlay);
+				updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, static_cast<int>(i), evaluationData.size(), static_cast<int>(j), maximumScore, maximumTotalScore);
+				cv::waitKey(gotResult ? 3000 : 1000);
+			}
 
 			++competitor.numVideosTested;
 		}
 
+		std::cout << "Decoded " << frameCache.getNumDecodedFrames() << " frame(s) of this video with " << frameCache.getNumSeeks() << " seek(s)." << std::endl;
 		csvFile << std::endl;
 
 		if (i == evaluationData.size() - 1)
@@ -512,8 +3369,11 @@ int main(int numArgs, const char** pp_args)
 			for (const Competitor& competitor : competitors)
 				csvFile << ';' << competitor.totalScore;
 
-			frame = cv::Vec3b::all(255);
-			cv::imshow(videoWindowName, frame);
+			if (!options.headless)
+			{
+				frame = cv::Vec3b::all(255);
+				cv::imshow(videoWindowName, frame);
+			}
 		}
 
 		for (Competitor& competitor : competitors)
@@ -523,13 +3383,69 @@ int main(int numArgs, const char** pp_args)
 		}
 	}
 
-	updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, -1, 0, -1, 0, maximumTotalScore);
-	cv::waitKey();
+	// Waits for the remaining overlay images.
+	p_overlayWriter.reset();
+
+	if (!options.headless)
+	{
+		updateRankingWindow(rankingWindowName, rankingFrameSize, competitors, -1, 0, -1, 0, maximumTotalScore);
+		cv::waitKey();
+	}
 
 	std::cout << std::endl;
 	std::cout << "Final scores (max. " << maximumTotalScore << " points):" << std::endl;
 	for (const auto& competitor : competitors)
 		std::cout << "- " << competitor.name << ": " << competitor.totalScore << " points" << std::endl;
 
+	if (benchmarkCsvFile.is_open())
+	{
+		std::cout << std::endl;
+		std::cout << "Latencies of the successful runs over all videos (min/median/p95/max):" << std::endl;
+		for (size_t j = 0; j < competitors.size(); ++j)
+		{
+			LatencySummary summary = summarizeLatencies(competitorLatenciesMs[j]);
+			benchmarkCsvFile << "All," << competitors[j].name << ',' << competitorLatenciesMs[j].size() << ',' << competitorNumFailedRuns[j] << ',' << summary.minMs << ',' << summary.medianMs << ',' << summary.p95Ms << ',' << summary.maxMs << std::endl;
+			std::cout << "- " << competitors[j].name << ": " << summary.minMs << '/' << summary.medianMs << '/' << summary.p95Ms << '/' << summary.maxMs << " ms";
+			if (competitorNumFailedRuns[j] != 0)
+				std::cout << " (" << competitorNumFailedRuns[j] << " failed run(s) not included)";
+			std::cout << std::endl;
+		}
+	}
+
+	if (std::any_of(stageBreakdowns.begin(), stageBreakdowns.end(), [](const StageBreakdown& breakdown) { return !breakdown.stageTimesMs.empty() || !breakdown.counters.empty(); }))
+	{
+		std::cout << std::endl;
+		std::cout << "Stage breakdown over all videos with a result (total, share of the wall time, mean per video):" << std::endl;
+		for (size_t j = 0; j < competitors.size(); ++j)
+		{
+			const StageBreakdown& breakdown = stageBreakdowns[j];
+			if (breakdown.stageTimesMs.empty() && breakdown.counters.empty())
+				continue;
+
+			std::cout << "- " << competitors[j].name << " (" << breakdown.numVideos << " video(s), " << breakdown.wallTimeMs << " ms wall):" << std::endl;
+			for (const auto& stageTime : breakdown.stageTimesMs)
+			{
+				stagesCsvFile << "All," << competitors[j].name << ",stage," << stageTime.first << ',' << stageTime.second << std::endl;
+				std::cout << "  - " << stageTime.first << ": " << std::fixed << std::setprecision(1) << stageTime.second << " ms, " << 100 * stageTime.second / std::max<uint64_t>(1, breakdown.wallTimeMs) << " %, " << stageTime.second / breakdown.numVideos << " ms" << std::defaultfloat << std::endl;
+			}
+			for (const auto& counter : breakdown.counters)
+			{
+				stagesCsvFile << "All," << competitors[j].name << ",counter," << counter.first << ',' << counter.second << std::endl;
+				std::cout << "  - " << counter.first << " (counter): " << counter.second << ", " << static_cast<double>(counter.second) / breakdown.numVideos << " per video" << std::endl;
+			}
+		}
+	}
+
+	if (options.scoreSelfCheck)
+	{
+		std::cout << std::endl;
+		if (numScoreSelfCheckMismatches != 0)
+		{
+			std::cerr << "Score self-check failed with " << numScoreSelfCheckMismatches << " mismatch(es)!" << std::endl;
+			return 1;
+		}
+		std::cout << "Score self-check passed: Rasterized and polygon-test scoring agree on the whole dataset." << std::endl;
+	}
+
 	return 0;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <experimental/filesystem>
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "../Common/FramePool.hpp"
 
 // Callback function for mouse interaction.
 void mouseEvent(int evt,
@@ -27,6 +28,9 @@ int main(int argc,
 {
 	std::string baseDirectory = std::experimental::filesystem::path(argv[0]).parent_path().string() + "/../../";
 
+	// With "--verbose", the statistics of the frame pool are printed at the end.
+	bool verbose = argc == 2 && std::string(argv[1]) == "--verbose";
+
 	// Create an image of size 320x240 with 3 channels of 8-bit unsigned integers.
 	// Draw a red anti-aliased line of thickness 3 from (10, 10) to (200, 100).
 	// Draw a filled green ellipse with center (160, 128), width 100, height 50 and angle 20.
@@ -69,8 +73,15 @@ int main(int argc,
 	const std::string WINDOW_NAME = "Video";
 	cv::namedWindow(WINDOW_NAME);
 
+	// The frames of the loop take their memory from a pool, so after the first frame nothing is allocated anymore (see the statistics at the end, with "--verbose").
+	// The pool has to outlive the matrices attached to it.
+	FramePool framePool("Example");
+
 	// This matrix will contain our image.
 	cv::Mat frame;
+	cv::Mat filteredFrame;
+	framePool.attach(frame);
+	framePool.attach(filteredFrame);
 
 	// Set the mouse interaction callback function for the window.
 	// The image matrix will be passed as a parameter.
@@ -93,12 +104,13 @@ int main(int argc,
 		}
 
 		// Apply a 5x5 median filter.
-		cv::medianBlur(frame, frame, 5);
+		cv::medianBlur(frame, filteredFrame, 5);
 
 		// We will add the other image to our camera image.
 		// If its size is not the same as the camera frame, resize it (this will only happen once).
 		if (koalaImage.size() != frame.size()) cv::resize(koalaImage, koalaImage, frame.size(), 0, 0, cv::INTER_CUBIC);
-		frame = 0.75 * frame + 0.25 * koalaImage;
+		// Unlike "frame = 0.75 * filteredFrame + 0.25 * koalaImage", this writes into the existing frame instead of a new matrix.
+		cv::addWeighted(filteredFrame, 0.75, koalaImage, 0.25, 0.0, frame);
 
 		// Display a text.
 		cv::putText(frame, "Click somewhere!", cv::Point(50, 50), cv::FONT_HERSHEY_PLAIN, 1.5, cv::Scalar(255, 0, 255), 2);
@@ -122,6 +134,8 @@ int main(int argc,
 		}
 	}
 
+	if (verbose)
+		framePool.printStatistics(std::cout);
 	std::cout << "That's it!" << std::endl;
 
 	return 0;
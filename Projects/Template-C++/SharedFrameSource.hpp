@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#if __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Header of the shared-memory segment into which the evaluation decodes each video once for all competitors. The frames follow at frameOffset, frameStride bytes apart.
+// The layout must match SharedFramesHeader in "Evaluation.cpp".
+struct SharedFramesHeader
+{
+	enum State : uint32_t { DECODING = 0, END_OF_VIDEO = 1, CAPACITY_REACHED = 2, FAILED = 3 };
+
+	char magic[8];
+	char videoFilename[256];
+	uint32_t width;
+	uint32_t height;
+	int32_t type;
+	uint32_t capacity;
+	uint64_t frameOffset;
+	uint64_t frameStride;
+	double fps;
+	uint32_t numVideoFrames;
+
+	// Frames below numFramesReady are complete and never change again.
+	std::atomic<uint32_t> numFramesReady;
+	std::atomic<uint32_t> state;
+};
+
+// Drop-in replacement for a file-backed cv::VideoCapture. When started by the evaluation with shared frames enabled, the frames are taken from the shared-memory segment named by the environment variable DICE_SHARED_FRAMES (or, in worker mode, by the request) instead of being decoded again; otherwise (or for a different video) it simply opens the video file.
+// read()/retrieve() return views of the shared frames without copying them. The segment is mapped copy-on-write, so modifying a frame in place is allowed and stays private. Frames beyond what the evaluation stored are decoded from the file as usual.
+class SharedFrameSource : public cv::VideoCapture
+{
+public:
+	explicit SharedFrameSource(const std::string& videoFilename)
+		: SharedFrameSource(videoFilename, getEnvironmentSegmentName())
+	{
+	}
+
+	// An empty segment name means no shared frames.
+	SharedFrameSource(const std::string& videoFilename, const std::string& segmentName)
+		: videoFilename(videoFilename)
+	{
+		if (!attach(segmentName))
+			cv::VideoCapture::open(videoFilename);
+	}
+
+	SharedFrameSource(const SharedFrameSource&) = delete;
+	SharedFrameSource& operator=(const SharedFrameSource&) = delete;
+
+	~SharedFrameSource()
+	{
+		detach();
+	}
+
+	// Whether the frames come from the evaluation's shared memory.
+	bool isShared() const
+	{
+		return p_header != nullptr;
+	}
+
+	bool isOpened() const override
+	{
+		return p_header || cv::VideoCapture::isOpened();
+	}
+
+	void release() override
+	{
+		detach();
+		cv::VideoCapture::release();
+	}
+
+	bool grab() override
+	{
+		if (!p_header)
+			return cv::VideoCapture::grab();
+
+		grabbedFrameNo = -1;
+		grabbedPrivately = false;
+		if (nextFrameNo < p_header->capacity)
+		{
+			if (waitForFrame(nextFrameNo))
+			{
+				grabbedFrameNo = nextFrameNo++;
+				return true;
+			}
+			if (p_header->state.load() == SharedFramesHeader::END_OF_VIDEO)
+				return false;
+		}
+
+		// The frame was not stored by the evaluation, decode it from the file.
+		if (privateFrameNo != nextFrameNo)
+		{
+			if (!cv::VideoCapture::isOpened() && !cv::VideoCapture::open(videoFilename))
+				return false;
+			cv::VideoCapture::set(cv::CAP_PROP_POS_FRAMES, nextFrameNo);
+		}
+		if (!cv::VideoCapture::grab())
+			return false;
+		privateFrameNo = nextFrameNo + 1;
+		grabbedFrameNo = nextFrameNo++;
+		grabbedPrivately = true;
+		return true;
+	}
+
+	bool retrieve(cv::OutputArray image, int flag = 0) override
+	{
+		if (!p_header || grabbedPrivately)
+			return cv::VideoCapture::retrieve(image, flag);
+
+		if (grabbedFrameNo == -1)
+		{
+			image.release();
+			return false;
+		}
+
+		uchar* p_frame = reinterpret_cast<uchar*>(p_header) + p_header->frameOffset + grabbedFrameNo * p_header->frameStride;
+		image.assign(cv::Mat(static_cast<int>(p_header->height), static_cast<int>(p_header->width), p_header->type, p_frame));
+		return true;
+	}
+
+	bool read(cv::OutputArray image) override
+	{
+		if (!grab())
+		{
+			image.release();
+			return false;
+		}
+		return retrieve(image);
+	}
+
+	cv::VideoCapture& operator>>(cv::Mat& image) override
+	{
+		read(image);
+		return *this;
+	}
+
+	double get(int propId) const override
+	{
+		if (!p_header)
+			return cv::VideoCapture::get(propId);
+
+		switch (propId)
+		{
+		case cv::CAP_PROP_POS_FRAMES:
+			return nextFrameNo;
+		case cv::CAP_PROP_FRAME_COUNT:
+			return p_header->numVideoFrames;
+		case cv::CAP_PROP_FRAME_WIDTH:
+			return p_header->width;
+		case cv::CAP_PROP_FRAME_HEIGHT:
+			return p_header->height;
+		case cv::CAP_PROP_FPS:
+			return p_header->fps;
+		default:
+			return cv::VideoCapture::isOpened() ? cv::VideoCapture::get(propId) : 0;
+		}
+	}
+
+	bool set(int propId, double value) override
+	{
+		if (!p_header)
+			return cv::VideoCapture::set(propId, value);
+
+		if (propId != cv::CAP_PROP_POS_FRAMES || value < 0)
+			return false;
+		nextFrameNo = static_cast<uint32_t>(value);
+		grabbedFrameNo = -1;
+		grabbedPrivately = false;
+		return true;
+	}
+
+private:
+	static std::string getEnvironmentSegmentName()
+	{
+		const char* p_segmentName = std::getenv("DICE_SHARED_FRAMES");
+		return p_segmentName ? p_segmentName : "";
+	}
+
+	bool attach(const std::string& segmentName)
+	{
+#if __unix__
+		if (segmentName.empty())
+			return false;
+
+		int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+		if (fd == -1)
+			return false;
+		struct stat fileStatus;
+		if (fstat(fd, &fileStatus) != 0 || static_cast<size_t>(fileStatus.st_size) < sizeof(SharedFramesHeader))
+		{
+			close(fd);
+			return false;
+		}
+
+		// MAP_PRIVATE: frames modified by the competitor are copied on write, while untouched pages keep showing what the evaluation writes.
+		mappingSize = static_cast<size_t>(fileStatus.st_size);
+		void* p_mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (p_mapping == MAP_FAILED)
+			return false;
+
+		p_header = static_cast<SharedFramesHeader*>(p_mapping);
+		if (std::memcmp(p_header->magic, "DICEFRM1", 8) != 0 || videoFilename != std::string(p_header->videoFilename, strnlen(p_header->videoFilename, sizeof(p_header->videoFilename)))
+			|| p_header->frameOffset + static_cast<uint64_t>(p_header->capacity) * p_header->frameStride > mappingSize)
+		{
+			detach();
+			return false;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void detach()
+	{
+#if __unix__
+		if (p_header)
+			munmap(p_header, mappingSize);
+#endif
+		p_header = nullptr;
+	}
+
+	// Returns false if the frame will never become available in the shared memory.
+	bool waitForFrame(uint32_t frameNo) const
+	{
+		while (frameNo >= p_header->numFramesReady.load(std::memory_order_acquire))
+		{
+			if (p_header->state.load(std::memory_order_acquire) != SharedFramesHeader::DECODING)
+				return frameNo < p_header->numFramesReady.load(std::memory_order_acquire);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	const std::string videoFilename;
+	SharedFramesHeader* p_header = nullptr;
+	size_t mappingSize = 0;
+	uint32_t nextFrameNo = 0;
+	int64_t grabbedFrameNo = -1;
+	bool grabbedPrivately = false;
+
+	// Position of the file-backed capture (only used for frames that are not in the shared memory).
+	uint32_t privateFrameNo = UINT32_MAX;
+};
@@ -1,6 +1,29 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include "SharedFrameSource.hpp"
+#include "../Common/FramePool.hpp"
 
 struct DetectedDie
 {
@@ -18,52 +41,1957 @@ struct DetectionResult
 
 	// One item for each die that you detected.
 	std::vector<DetectedDie> detectedDice;
+
+	// Optional: Milliseconds spent in each stage of your detection, shown in the evaluation's stage breakdown (see ScopedStageTimer below).
+	std::vector<std::pair<std::string, double>> stageTimesMs;
+
+	// Optional: Counters shown in the evaluation's stage breakdown, e.g. the number of decoded frames (see addCounter below).
+	std::vector<std::pair<std::string, int64_t>> counters;
+};
+
+// Stage and counter names must not contain whitespace. Repeated stages (e.g. within a loop) are summed up.
+void addStageTime(DetectionResult& detectionResult, const std::string& stageName, double milliseconds)
+{
+	for (auto& stageTime : detectionResult.stageTimesMs)
+		if (stageTime.first == stageName)
+		{
+			stageTime.second += milliseconds;
+			return;
+		}
+	detectionResult.stageTimesMs.emplace_back(stageName, milliseconds);
+}
+
+void addCounter(DetectionResult& detectionResult, const std::string& counterName, int64_t increment = 1)
+{
+	for (auto& counter : detectionResult.counters)
+		if (counter.first == counterName)
+		{
+			counter.second += increment;
+			return;
+		}
+	detectionResult.counters.emplace_back(counterName, increment);
+}
+
+// Adds the time until the end of its scope to the given stage, e.g. "{ ScopedStageTimer timer(detectionResult, "segmentation"); ... }".
+// Close the scope before returning the detection result, otherwise the time may be added after the result has been copied.
+class ScopedStageTimer
+{
+public:
+	ScopedStageTimer(DetectionResult& detectionResult, const std::string& stageName)
+		: detectionResult(detectionResult), stageName(stageName), t0(cv::getTickCount())
+	{
+	}
+
+	~ScopedStageTimer()
+	{
+		addStageTime(detectionResult, stageName, 1000.0 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+	}
+
+private:
+	DetectionResult& detectionResult;
+	const std::string stageName;
+	const int64 t0;
 };
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // ! You should not change anything ABOVE this point. !
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
-// TODO: Implement this function!
+// A decoded frame on its way through the FramePipeline. The buffers are preallocated and recycled, so the images keep their memory from frame to frame.
+struct PipelineFrame
+{
+	uint frameNo = 0;
+	uint sequenceNo = 0;
+	cv::Mat3b image;
+
+	// Result of the parallel analysis, passed on to the in-order stage.
+	cv::Mat analysis;
+};
+
+// Decodes the video on the calling thread while analysis threads process the selected frames, so decoding never waits for the analysis (and vice versa). Frames that are not selected are only grabbed, never retrieved (no color conversion and copy).
+// The frames travel through a bounded queue and go back to a free list afterwards, their images and analysis results keep their memory (from the pipeline's frame pool) from one use to the next. The final stage sees the frames one at a time in frame order, so everything that depends on the order (like the reference frame number) stays exact.
+class FramePipeline
+{
+public:
+	// Called on the decoding thread: whether the frame is passed on.
+	typedef std::function<bool(uint frameNo)> SelectFunction;
+
+	// Called concurrently for different frames.
+	typedef std::function<void(PipelineFrame& frame)> AnalyzeFunction;
+
+	// Called for one frame at a time, in frame order. Returning false stops the pipeline: decoding ends and the frames after this one are dropped.
+	typedef std::function<bool(const PipelineFrame& frame)> CommitFunction;
+
+	// Called after the commit of a frame, concurrently with the commits of the following frames, before the frame's buffer is reused. For work that needs the frame but must not hold up the in-order stage.
+	typedef std::function<void(const PipelineFrame& frame)> FinishFunction;
+
+	// 0 analysis threads = as many as OpenCV uses, minus the decoding thread.
+	explicit FramePipeline(uint numAnalysisThreads = 0)
+		: numAnalysisThreads(numAnalysisThreads != 0 ? numAnalysisThreads : static_cast<uint>(std::max(1, cv::getNumThreads() - 1))), buffers(this->numAnalysisThreads + 2)
+	{
+		for (PipelineFrame& buffer : buffers)
+		{
+			framePool.attach(buffer.image);
+			framePool.attach(buffer.analysis);
+		}
+	}
+
+	// Frames shared by the evaluation replace the images' buffers by views, which the pool does not see.
+	FramePool::Statistics getFramePoolStatistics() const
+	{
+		return framePool.getStatistics();
+	}
+
+	// Returns the number of decoded (grabbed) frames. Exceptions of the analysis, commit and finish functions are passed on.
+	uint run(cv::VideoCapture& videoCapture, const SelectFunction& select, const AnalyzeFunction& analyze, const CommitFunction& commit, const FinishFunction& finish = FinishFunction())
+	{
+		freeBuffers.clear();
+		for (PipelineFrame& buffer : buffers)
+			freeBuffers.push_back(&buffer);
+		queue.clear();
+		decodingDone = false;
+		stopRequested = false;
+		nextCommitSequenceNo = 0;
+		p_exception = nullptr;
+
+		std::vector<std::thread> analysisThreads;
+		for (uint i = 0; i < numAnalysisThreads; ++i)
+			analysisThreads.emplace_back(&FramePipeline::analysisThreadMain, this, std::cref(analyze), std::cref(commit), std::cref(finish));
+
+		uint frameNo = 0;
+		uint sequenceNo = 0;
+		for (; !stopRequested; ++frameNo)
+		{
+			if (!select(frameNo))
+			{
+				if (!videoCapture.grab())
+					break;
+				continue;
+			}
+
+			PipelineFrame* p_frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				freeBufferCondition.wait(lock, [&]() { return !freeBuffers.empty() || p_exception; });
+				if (p_exception)
+					break;
+				p_frame = freeBuffers.back();
+				freeBuffers.pop_back();
+			}
+
+			if (!videoCapture.read(p_frame->image))
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				freeBuffers.push_back(p_frame);
+				break;
+			}
+
+			p_frame->frameNo = frameNo;
+			p_frame->sequenceNo = sequenceNo++;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queue.push_back(p_frame);
+			}
+			queueCondition.notify_one();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decodingDone = true;
+		}
+		queueCondition.notify_all();
+		for (std::thread& analysisThread : analysisThreads)
+			analysisThread.join();
+
+		if (p_exception)
+			std::rethrow_exception(p_exception);
+		return frameNo;
+	}
+
+private:
+	void analysisThreadMain(const AnalyzeFunction& analyze, const CommitFunction& commit, const FinishFunction& finish)
+	{
+		for (;;)
+		{
+			PipelineFrame* p_frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [&]() { return !queue.empty() || decodingDone || p_exception; });
+				if (queue.empty() || p_exception)
+					return;
+				p_frame = queue.front();
+				queue.pop_front();
+			}
+
+			try
+			{
+				analyze(*p_frame);
+
+				// The queue is FIFO, so the frames before this one are already taken by other threads and will be committed.
+				std::unique_lock<std::mutex> lock(mutex);
+				commitCondition.wait(lock, [&]() { return nextCommitSequenceNo == p_frame->sequenceNo || p_exception; });
+				if (p_exception)
+					return;
+				bool committed = !stopRequested;
+				if (committed)
+				{
+					lock.unlock();
+					bool keepGoing = commit(*p_frame);
+					lock.lock();
+					if (!keepGoing)
+						stopRequested = true;
+				}
+				++nextCommitSequenceNo;
+
+				// The next frame may be committed while this one is finished.
+				if (committed && finish)
+				{
+					lock.unlock();
+					commitCondition.notify_all();
+					finish(*p_frame);
+					lock.lock();
+				}
+				freeBuffers.push_back(p_frame);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!p_exception)
+					p_exception = std::current_exception();
+			}
+			commitCondition.notify_all();
+			freeBufferCondition.notify_one();
+			queueCondition.notify_all();
+		}
+	}
+
+	const uint numAnalysisThreads;
+	// Declared before the buffers, which give their memory back to it when they are destroyed.
+	FramePool framePool{ "FramePipeline" };
+	std::vector<PipelineFrame> buffers;
+	std::vector<PipelineFrame*> freeBuffers;
+	std::deque<PipelineFrame*> queue;
+	bool decodingDone = false;
+	std::atomic<bool> stopRequested{ false };
+	uint nextCommitSequenceNo = 0;
+	std::exception_ptr p_exception;
+	std::mutex mutex;
+	std::condition_variable freeBufferCondition;
+	std::condition_variable queueCondition;
+	std::condition_variable commitCondition;
+};
+
+// Fused preprocessing of a BGR frame into a grayscale image: gray conversion, optional downscaling by an integer factor (block averages like cv::resize with INTER_AREA) and optional denoising of the downscaled image, either 3x3 binomial (like cv::GaussianBlur with a 3x3 kernel) or median (like cv::medianBlur with a 3x3 or 5x5 aperture).
+// The unfused operations each make a pass over the whole frame and write a full-size intermediate image; here the output is produced in tiles of rows, and a tile's intermediate rows stay in the cache.
+class FusedPreprocessor
+{
+public:
+	// Maximum deviation from applyReference in gray levels: the block averages are rounded half up, cv::resize may round half to even. The median of values off by at most one is off by at most one as well.
+	enum { TOLERANCE = 1 };
+
+	enum Denoising
+	{
+		NO_DENOISING,
+		// The borders reflect like BORDER_REFLECT_101.
+		BINOMIAL_3X3,
+		// The borders are replicated like in cv::medianBlur.
+		MEDIAN_3X3,
+		MEDIAN_5X5
+	};
+
+	FusedPreprocessor(int downscaleFactor, Denoising denoising)
+		: downscaleFactor(std::max(downscaleFactor, 1)), denoising(denoising)
+	{
+		// The column sums of a block are accumulated in 16 bits.
+		if (this->downscaleFactor > 16)
+			throw std::invalid_argument("The downscale factor of the preprocessing must not be greater than 16!");
+	}
+
+	// Frame rows and columns beyond the last complete block are ignored.
+	cv::Size getOutputSize(const cv::Size& frameSize) const
+	{
+		return cv::Size(frameSize.width / downscaleFactor, frameSize.height / downscaleFactor);
+	}
+
+	// Writes into the existing memory of the output image if it has the right size and type.
+	void apply(const cv::Mat3b& frame, cv::Mat& outImage) const
+	{
+		cv::Size outputSize = getOutputSize(frame.size());
+		outImage.create(outputSize, CV_8UC1);
+		if (outputSize.area() == 0)
+			return;
+
+		int numTiles = (outputSize.height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+		cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range& range)
+		{
+			for (int tileNo = range.start; tileNo < range.end; ++tileNo)
+				processTile(frame, outImage, tileNo * TILE_HEIGHT, std::min((tileNo + 1) * TILE_HEIGHT, outputSize.height));
+		});
+	}
+
+	// The same operations with one OpenCV call each.
+	void applyReference(const cv::Mat3b& frame, cv::Mat1b& outImage) const
+	{
+		cv::Size outputSize = getOutputSize(frame.size());
+		cv::Mat1b gray;
+		cv::cvtColor(frame(cv::Rect(0, 0, outputSize.width * downscaleFactor, outputSize.height * downscaleFactor)), gray, cv::COLOR_BGR2GRAY);
+		if (downscaleFactor > 1)
+			cv::resize(gray, gray, outputSize, 0, 0, cv::INTER_AREA);
+		switch (denoising)
+		{
+		case BINOMIAL_3X3:
+			cv::GaussianBlur(gray, outImage, cv::Size(3, 3), 0, 0, cv::BORDER_REFLECT_101);
+			break;
+		case MEDIAN_3X3:
+			cv::medianBlur(gray, outImage, 3);
+			break;
+		case MEDIAN_5X5:
+			cv::medianBlur(gray, outImage, 5);
+			break;
+		default:
+			outImage = gray;
+		}
+	}
+
+	// Compares apply with applyReference on synthetic frames for all downscale factors used by the detector and all kinds of denoising. Returns false if any deviation exceeds TOLERANCE.
+	static bool checkAgainstReference(std::ostream& log)
+	{
+		bool passed = true;
+		cv::RNG rng(1936 * 1216);
+		const cv::Size frameSizes[] = { cv::Size(1936, 1216), cv::Size(37, 23), cv::Size(17, 9) };
+		for (const cv::Size& frameSize : frameSizes)
+		{
+			// The noise covers all values and both SIMD and scalar paths; the smooth gradient is where a systematic rounding error would show.
+			cv::Mat3b noiseFrame(frameSize);
+			rng.fill(noiseFrame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+			cv::Mat3b gradientFrame(frameSize);
+			for (int y = 0; y < frameSize.height; ++y)
+				for (int x = 0; x < frameSize.width; ++x)
+					gradientFrame(y, x) = cv::Vec3b(static_cast<uchar>(255 * x / frameSize.width), static_cast<uchar>(255 * y / frameSize.height), static_cast<uchar>(255 * (x + y) / (frameSize.width + frameSize.height)));
+
+			for (const cv::Mat3b* p_frame : { &noiseFrame, &gradientFrame })
+				for (int downscaleFactor : { 1, 2, 4, 8 })
+					for (Denoising denoising : { NO_DENOISING, BINOMIAL_3X3, MEDIAN_3X3, MEDIAN_5X5 })
+					{
+						FusedPreprocessor preprocessor(downscaleFactor, denoising);
+						if (preprocessor.getOutputSize(frameSize).area() == 0)
+							continue;
+
+						cv::Mat1b image, referenceImage;
+						preprocessor.apply(*p_frame, image);
+						preprocessor.applyReference(*p_frame, referenceImage);
+						double maximumDeviation = cv::norm(image, referenceImage, cv::NORM_INF);
+						bool deviationTolerated = maximumDeviation <= TOLERANCE;
+						log << (deviationTolerated ? "OK    " : "FAILED") << " preprocessing of " << frameSize.width << 'x' << frameSize.height << (p_frame == &noiseFrame ? " noise" : " gradient") << ", downscale factor " << downscaleFactor << getDenoisingName(denoising) << ": maximum deviation " << maximumDeviation << std::endl;
+						passed = passed && deviationTolerated;
+					}
+		}
+		return passed;
+	}
+
+private:
+	// Output rows per tile, the unit of parallelization. The live data of a tile are a few rows, independent of the tile height.
+	enum { TILE_HEIGHT = 16 };
+
+	// Elements of a row buffer kept on the stack, enough for 4K frames.
+	enum { ROW_BUFFER_SIZE = 4096 };
+
+	// OpenCV's fixed-point coefficients of COLOR_BGR2GRAY, which makes the conversion bit-exact.
+	enum { GRAY_SHIFT = 14, BLUE_TO_GRAY = 1868, GREEN_TO_GRAY = 9617, RED_TO_GRAY = 4899 };
+
+	// Radius of the largest denoising kernel.
+	enum { MAX_RADIUS = 2 };
+
+	static const char* getDenoisingName(Denoising denoising)
+	{
+		switch (denoising)
+		{
+		case BINOMIAL_3X3:
+			return ", binomial 3x3";
+		case MEDIAN_3X3:
+			return ", median 3x3";
+		case MEDIAN_5X5:
+			return ", median 5x5";
+		default:
+			return "";
+		}
+	}
+
+	int getRadius() const
+	{
+		return denoising == NO_DENOISING ? 0 : denoising == MEDIAN_5X5 ? 2 : 1;
+	}
+
+	// Index of a neighbour beyond the border like BORDER_REFLECT_101, for neighbours at most one pixel outside.
+	static int reflectIndex(int index, int size)
+	{
+		if (size == 1)
+			return 0;
+		if (index < 0)
+			return -index;
+		if (index >= size)
+			return 2 * size - 2 - index;
+		return index;
+	}
+
+	// Index of a neighbour beyond the border like BORDER_REPLICATE.
+	static int replicateIndex(int index, int size)
+	{
+		return std::min(std::max(index, 0), size - 1);
+	}
+
+	// The row buffers of a tile live on the stack for frames up to ROW_BUFFER_SIZE pixels wide, so the steady state allocates nothing.
+	void processTile(const cv::Mat3b& frame, cv::Mat& outImage, int firstRowNo, int endRowNo) const
+	{
+		cv::AutoBuffer<uchar, ROW_BUFFER_SIZE> grayRow(outImage.cols * downscaleFactor);
+		cv::AutoBuffer<ushort, ROW_BUFFER_SIZE> columnSums(outImage.cols * downscaleFactor);
+		int radius = getRadius();
+		if (radius == 0)
+		{
+			for (int y = firstRowNo; y < endRowNo; ++y)
+				computeRow(frame, y, grayRow.data(), columnSums.data(), outImage.ptr<uchar>(y), outImage.cols);
+			return;
+		}
+
+		// The kernel's most recent downscaled rows, row y is at (y + numRows) mod numRows. Each tile computes the rows above and below itself again instead of synchronizing with its neighbours.
+		int numRows = 2 * radius + 1;
+		cv::AutoBuffer<uchar, (2 * MAX_RADIUS + 1) * ROW_BUFFER_SIZE> rows(numRows * outImage.cols);
+		cv::AutoBuffer<ushort, ROW_BUFFER_SIZE> verticalSums(outImage.cols);
+		auto getRow = [&](int y) { return &rows[(y + numRows) % numRows * outImage.cols]; };
+		auto getBorderIndex = [&](int y) { return denoising == BINOMIAL_3X3 ? reflectIndex(y, outImage.rows) : replicateIndex(y, outImage.rows); };
+		for (int y = firstRowNo - radius; y < firstRowNo + radius; ++y)
+			computeRow(frame, getBorderIndex(y), grayRow.data(), columnSums.data(), getRow(y), outImage.cols);
+		for (int y = firstRowNo; y < endRowNo; ++y)
+		{
+			computeRow(frame, getBorderIndex(y + radius), grayRow.data(), columnSums.data(), getRow(y + radius), outImage.cols);
+			if (denoising == BINOMIAL_3X3)
+				blurRow(getRow(y - 1), getRow(y), getRow(y + 1), verticalSums.data(), outImage.ptr<uchar>(y), outImage.cols);
+			else
+			{
+				const uchar* pp_kernelRows[2 * MAX_RADIUS + 1];
+				for (int i = 0; i < numRows; ++i)
+					pp_kernelRows[i] = getRow(y - radius + i);
+				medianRow(pp_kernelRows, radius, outImage.ptr<uchar>(y), outImage.cols);
+			}
+		}
+	}
+
+	// Computes downscaled row y from its block of frame rows.
+	void computeRow(const cv::Mat3b& frame, int y, uchar* p_grayRow, ushort* p_columnSums, uchar* p_outRow, int width) const
+	{
+		if (downscaleFactor == 1)
+		{
+			convertRowToGray(frame.ptr<uchar>(y), p_outRow, width);
+			return;
+		}
+
+		int frameWidth = width * downscaleFactor;
+		std::fill(p_columnSums, p_columnSums + frameWidth, 0);
+		for (int i = 0; i < downscaleFactor; ++i)
+		{
+			convertRowToGray(frame.ptr<uchar>(y * downscaleFactor + i), p_grayRow, frameWidth);
+			accumulateRow(p_grayRow, p_columnSums, frameWidth);
+		}
+
+		int blockArea = downscaleFactor * downscaleFactor;
+		for (int x = 0; x < width; ++x)
+		{
+			uint blockSum = 0;
+			for (int i = 0; i < downscaleFactor; ++i)
+				blockSum += p_columnSums[x * downscaleFactor + i];
+			p_outRow[x] = static_cast<uchar>((blockSum + blockArea / 2) / blockArea);
+		}
+	}
+
+	static void convertRowToGray(const uchar* p_bgrRow, uchar* p_outGrayRow, int width)
+	{
+		int x = 0;
+#if CV_SIMD128
+		const cv::v_uint32x4 blueWeight = cv::v_setall_u32(BLUE_TO_GRAY), greenWeight = cv::v_setall_u32(GREEN_TO_GRAY), redWeight = cv::v_setall_u32(RED_TO_GRAY);
+		const cv::v_uint32x4 rounding = cv::v_setall_u32(1 << (GRAY_SHIFT - 1));
+		for (; x <= width - 16; x += 16)
+		{
+			cv::v_uint8x16 blue, green, red;
+			cv::v_load_deinterleave(p_bgrRow + 3 * x, blue, green, red);
+			cv::v_uint16x8 blue16[2], green16[2], red16[2], gray16[2];
+			cv::v_expand(blue, blue16[0], blue16[1]);
+			cv::v_expand(green, green16[0], green16[1]);
+			cv::v_expand(red, red16[0], red16[1]);
+			for (int half = 0; half < 2; ++half)
+			{
+				cv::v_uint32x4 blue32[2], green32[2], red32[2];
+				cv::v_expand(blue16[half], blue32[0], blue32[1]);
+				cv::v_expand(green16[half], green32[0], green32[1]);
+				cv::v_expand(red16[half], red32[0], red32[1]);
+				gray16[half] = cv::v_pack((blue32[0] * blueWeight + green32[0] * greenWeight + red32[0] * redWeight + rounding) >> GRAY_SHIFT,
+					(blue32[1] * blueWeight + green32[1] * greenWeight + red32[1] * redWeight + rounding) >> GRAY_SHIFT);
+			}
+			cv::v_store(p_outGrayRow + x, cv::v_pack(gray16[0], gray16[1]));
+		}
+#endif
+		for (; x < width; ++x)
+			p_outGrayRow[x] = static_cast<uchar>((p_bgrRow[3 * x] * BLUE_TO_GRAY + p_bgrRow[3 * x + 1] * GREEN_TO_GRAY + p_bgrRow[3 * x + 2] * RED_TO_GRAY + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT);
+	}
+
+	static void accumulateRow(const uchar* p_grayRow, ushort* p_columnSums, int width)
+	{
+		int x = 0;
+#if CV_SIMD128
+		for (; x <= width - 16; x += 16)
+		{
+			cv::v_uint16x8 low, high;
+			cv::v_expand(cv::v_load(p_grayRow + x), low, high);
+			cv::v_store(p_columnSums + x, cv::v_load(p_columnSums + x) + low);
+			cv::v_store(p_columnSums + x + 8, cv::v_load(p_columnSums + x + 8) + high);
+		}
+#endif
+		for (; x < width; ++x)
+			p_columnSums[x] += p_grayRow[x];
+	}
+
+	// Applies the kernel [1 2 1]^T [1 2 1] / 16 to the middle row, the sums stay below 2^12 and fit 16 bits.
+	static void blurRow(const uchar* p_rowAbove, const uchar* p_row, const uchar* p_rowBelow, ushort* p_verticalSums, uchar* p_outRow, int width)
+	{
+		int x = 0;
+#if CV_SIMD128
+		for (; x <= width - 16; x += 16)
+		{
+			cv::v_uint16x8 above[2], middle[2], below[2];
+			cv::v_expand(cv::v_load(p_rowAbove + x), above[0], above[1]);
+			cv::v_expand(cv::v_load(p_row + x), middle[0], middle[1]);
+			cv::v_expand(cv::v_load(p_rowBelow + x), below[0], below[1]);
+			cv::v_store(p_verticalSums + x, above[0] + (middle[0] << 1) + below[0]);
+			cv::v_store(p_verticalSums + x + 8, above[1] + (middle[1] << 1) + below[1]);
+		}
+#endif
+		for (; x < width; ++x)
+			p_verticalSums[x] = static_cast<ushort>(p_rowAbove[x] + 2 * p_row[x] + p_rowBelow[x]);
+
+		// The border columns reflect their neighbours, the inner columns load their neighbours unaligned.
+		auto filterColumn = [&](int x)
+		{
+			p_outRow[x] = static_cast<uchar>((p_verticalSums[reflectIndex(x - 1, width)] + 2 * p_verticalSums[x] + p_verticalSums[reflectIndex(x + 1, width)] + 8) >> 4);
+		};
+		filterColumn(0);
+		x = 1;
+#if CV_SIMD128
+		const cv::v_uint16x8 rounding = cv::v_setall_u16(8);
+		for (; x <= width - 17; x += 16)
+		{
+			cv::v_uint16x8 filtered[2];
+			for (int half = 0; half < 2; ++half)
+			{
+				const ushort* p_sums = p_verticalSums + x + 8 * half;
+				filtered[half] = (cv::v_load(p_sums - 1) + (cv::v_load(p_sums) << 1) + cv::v_load(p_sums + 1) + rounding) >> 4;
+			}
+			cv::v_store(p_outRow + x, cv::v_pack(filtered[0], filtered[1]));
+		}
+#endif
+		for (; x < width; ++x)
+			filterColumn(x);
+	}
+
+	// Comparators (lower index, higher index) of Batcher's odd-even merge sort of numValues values, a power of two, reduced to those that the value ending up at medianIndex depends on.
+	static std::vector<std::pair<int, int>> makeMedianNetwork(int numValues, int medianIndex)
+	{
+		std::vector<std::pair<int, int>> comparators;
+		for (int p = 1; p < numValues; p *= 2)
+			for (int k = p; k >= 1; k /= 2)
+				for (int j = k % p; j + k < numValues; j += 2 * k)
+					for (int i = 0; i < std::min(k, numValues - j - k); ++i)
+						if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+							comparators.emplace_back(i + j, i + j + k);
+
+		std::vector<bool> needed(numValues, false);
+		needed[medianIndex] = true;
+		std::vector<std::pair<int, int>> medianComparators;
+		for (auto it = comparators.rbegin(); it != comparators.rend(); ++it)
+			if (needed[it->first] || needed[it->second])
+			{
+				needed[it->first] = needed[it->second] = true;
+				medianComparators.push_back(*it);
+			}
+		std::reverse(medianComparators.begin(), medianComparators.end());
+		return medianComparators;
+	}
+
+	// Writes the median of the (2 radius + 1)^2 neighbourhood of each pixel of the middle kernel row, the columns beyond the border are replicated.
+	static void medianRow(const uchar* const* pp_kernelRows, int radius, uchar* p_outRow, int width)
+	{
+		int diameter = 2 * radius + 1;
+		auto filterColumn = [&](int x)
+		{
+			uchar values[(2 * MAX_RADIUS + 1) * (2 * MAX_RADIUS + 1)];
+			int numValues = 0;
+			for (int i = 0; i < diameter; ++i)
+				for (int j = -radius; j <= radius; ++j)
+					values[numValues++] = pp_kernelRows[i][replicateIndex(x + j, width)];
+			std::nth_element(values, values + numValues / 2, values + numValues);
+			p_outRow[x] = values[numValues / 2];
+		};
+		int x = 0;
+		for (; x < std::min(radius, width); ++x)
+			filterColumn(x);
+#if CV_SIMD128
+		// The inner columns sort 16 neighbourhoods at once with a sorting network of 16 (3x3) or 32 (5x5) values. The neighbourhood is padded with 3 zeros below and 4 255s above, which puts its median at the network's index 7 or 15.
+		static const std::vector<std::pair<int, int>> median3x3Network = makeMedianNetwork(16, 7), median5x5Network = makeMedianNetwork(32, 15);
+		const std::vector<std::pair<int, int>>& network = radius == 1 ? median3x3Network : median5x5Network;
+		int numNetworkValues = radius == 1 ? 16 : 32;
+		for (; x <= width - 16 - radius; x += 16)
+		{
+			cv::v_uint8x16 values[32];
+			int numValues = 0;
+			for (; numValues < 3; ++numValues)
+				values[numValues] = cv::v_setall_u8(0);
+			for (int i = 0; i < diameter; ++i)
+				for (int j = -radius; j <= radius; ++j)
+					values[numValues++] = cv::v_load(pp_kernelRows[i] + x + j);
+			for (; numValues < numNetworkValues; ++numValues)
+				values[numValues] = cv::v_setall_u8(255);
+			for (const std::pair<int, int>& comparator : network)
+			{
+				cv::v_uint8x16 lower = cv::v_min(values[comparator.first], values[comparator.second]);
+				values[comparator.second] = cv::v_max(values[comparator.first], values[comparator.second]);
+				values[comparator.first] = lower;
+			}
+			cv::v_store(p_outRow + x, values[numNetworkValues / 2 - 1]);
+		}
+#endif
+		for (; x < width; ++x)
+			filterColumn(x);
+	}
+
+	const int downscaleFactor;
+	const Denoising denoising;
+};
+
+// Configuration of the reference frame search. The defaults suit the evaluation videos (about 30 fps, static after the throw).
+struct FrameScanParameters
+{
+	// Frames from one sample to the next (0 = one sample per second).
+	uint sampleInterval = 0;
+
+	// Downscale factor of the grayscale samples.
+	int downscaleFactor = 8;
+
+	// Mean squared difference of two consecutive samples below which the video counts as still.
+	double stillnessThreshold = 4;
+
+	// Stop scanning after this many consecutive still sample pairs that follow some motion, i.e. once the dice have settled (0 = always scan the whole video).
+	uint numStillSamplesToStop = 3;
+};
+
+// Finds the stillest moment of the video in a single forward pass: each sampled frame is compared with the previous sample only, so nothing is seeked or re-read and the memory use does not depend on the video length.
+// The comparison runs on small grayscale images (sum of squared differences, computed by OpenCV's integer SIMD kernel for 8-bit images). The later frame of the stillest pair of consecutive samples becomes the reference frame.
+class StableFrameSelector
+{
+public:
+	// A downscale factor of 8 turns a 1936x1216 frame into 242x152 pixels, plenty to notice moving dice or hands.
+	explicit StableFrameSelector(const FrameScanParameters& parameters)
+		: parameters(parameters), samplePreprocessor(parameters.downscaleFactor, FusedPreprocessor::NO_DENOISING)
+	{
+	}
+
+	// Thread-safe, so the samples of several frames can be computed concurrently. Reuses the memory of the output sample.
+	void computeSample(const cv::Mat3b& frame, cv::Mat& outSample) const
+	{
+		samplePreprocessor.apply(frame, outSample);
+	}
+
+	// The samples have to be added in frame order.
+	void addSample(uint frameNo, const cv::Mat1b& sample, const cv::Mat3b& frame)
+	{
+		// The mean squared difference, like the notebook's MSE, but on integers. Ties go to the later pair, after the dice have settled.
+		double difference = previousSample.empty() ? std::numeric_limits<double>::max() : cv::norm(sample, previousSample, cv::NORM_L2SQR) / sample.total();
+		if (bestFrame.empty() || difference <= bestDifference)
+		{
+			bestDifference = difference;
+			bestFrameNo = frameNo;
+			frame.copyTo(bestFrame);
+		}
+
+		if (!previousSample.empty())
+		{
+			bool still = difference < parameters.stillnessThreshold;
+			motionSeen = motionSeen || !still;
+			numConsecutiveStillSamples = still && motionSeen ? numConsecutiveStillSamples + 1 : 0;
+		}
+
+		sample.copyTo(previousSample);
+		++numSamples;
+	}
+
+	// Whether the scan can stop: the video has been still long enough after the motion of the throw.
+	bool hasSettled() const
+	{
+		return parameters.numStillSamplesToStop != 0 && numConsecutiveStillSamples >= parameters.numStillSamplesToStop;
+	}
+
+	// The number of samples since the last motion, if the video has been still after some motion; these are the stable frames.
+	uint getNumConsecutiveStableSamples() const
+	{
+		return numConsecutiveStillSamples;
+	}
+
+	bool hasFrame() const
+	{
+		return !bestFrame.empty();
+	}
+
+	uint getBestFrameNo() const
+	{
+		return bestFrameNo;
+	}
+
+	const cv::Mat3b& getBestFrame() const
+	{
+		return bestFrame;
+	}
+
+	uint getNumSamples() const
+	{
+		return numSamples;
+	}
+
+private:
+	const FrameScanParameters parameters;
+	const FusedPreprocessor samplePreprocessor;
+	cv::Mat1b previousSample;
+	cv::Mat3b bestFrame;
+	uint bestFrameNo = 0;
+	double bestDifference = std::numeric_limits<double>::max();
+	uint numSamples = 0;
+	bool motionSeen = false;
+	uint numConsecutiveStillSamples = 0;
+};
+
+// Configuration of the background model, in gray levels of the downscaled samples (see FrameScanParameters).
+struct BackgroundModelParameters
+{
+	// Minimum difference from the background for a pixel to count as foreground.
+	uchar foregroundThreshold = 25;
+
+	// Maximum change of a pixel of the model per sample. Foreground pixels follow slower, so settled dice take long to fade into the background, while table that was covered at the start (e.g. by the hand) still does eventually.
+	uchar backgroundStep = 8;
+	uchar foregroundStep = 1;
+
+	// The foreground mask is not used if it covers more than this fraction of the frame, e.g. after a change of lighting.
+	double maximumForegroundFraction = 0.5;
+};
+
+// An incremental model of the static table at the resolution of the selector's samples: a running median approximation that moves every pixel toward the new sample by at most a fixed step.
+// The update and the foreground test are a few saturating byte operations per pixel, vectorized with universal intrinsics; nothing depends on the history of a pixel except its current model value.
+class BackgroundModel
+{
+public:
+	explicit BackgroundModel(const BackgroundModelParameters& parameters = BackgroundModelParameters())
+		: parameters(parameters)
+	{
+	}
+
+	// Computes the foreground of the sample against the model, then updates the model with the sample. The samples have to be added in frame order.
+	// Returns false without a usable mask: for the first sample, which only initializes the model, and if the foreground covers too much of the frame. The mask's memory is reused, also when it is not usable.
+	// The mask is not dilated: it is only used where it is needed, at the localization level (see DieClassifier), which keeps this per-sample update free of matrix allocations.
+	bool apply(const cv::Mat1b& sample, cv::Mat1b& outForegroundMask)
+	{
+		if (background.empty() || background.size() != sample.size())
+		{
+			sample.copyTo(background);
+			return false;
+		}
+
+		outForegroundMask.create(sample.size());
+		for (int y = 0; y < sample.rows; ++y)
+		{
+			computeForegroundRow(sample[y], background[y], outForegroundMask[y], sample.cols);
+			updateRow(sample[y], outForegroundMask[y], background[y], sample.cols);
+		}
+
+		return cv::countNonZero(outForegroundMask) <= parameters.maximumForegroundFraction * outForegroundMask.total();
+	}
+
+private:
+	void computeForegroundRow(const uchar* p_sampleRow, const uchar* p_backgroundRow, uchar* p_outForegroundRow, int width) const
+	{
+		int x = 0;
+#if CV_SIMD128
+		const cv::v_uint8x16 threshold = cv::v_setall_u8(parameters.foregroundThreshold);
+		for (; x <= width - 16; x += 16)
+			cv::v_store(p_outForegroundRow + x, cv::v_absdiff(cv::v_load(p_sampleRow + x), cv::v_load(p_backgroundRow + x)) > threshold);
+#endif
+		for (; x < width; ++x)
+			p_outForegroundRow[x] = std::abs(p_sampleRow[x] - p_backgroundRow[x]) > parameters.foregroundThreshold ? 255 : 0;
+	}
+
+	// background = clamp(sample, background - step, background + step), the vector additions and subtractions saturate.
+	void updateRow(const uchar* p_sampleRow, const uchar* p_foregroundRow, uchar* p_backgroundRow, int width) const
+	{
+		int x = 0;
+#if CV_SIMD128
+		const cv::v_uint8x16 foregroundStep = cv::v_setall_u8(parameters.foregroundStep), backgroundStep = cv::v_setall_u8(parameters.backgroundStep);
+		for (; x <= width - 16; x += 16)
+		{
+			cv::v_uint8x16 step = cv::v_select(cv::v_load(p_foregroundRow + x), foregroundStep, backgroundStep);
+			cv::v_uint8x16 background = cv::v_load(p_backgroundRow + x);
+			cv::v_store(p_backgroundRow + x, cv::v_min(cv::v_max(cv::v_load(p_sampleRow + x), background - step), background + step));
+		}
+#endif
+		for (; x < width; ++x)
+		{
+			int step = p_foregroundRow[x] != 0 ? parameters.foregroundStep : parameters.backgroundStep;
+			p_backgroundRow[x] = static_cast<uchar>(std::min(std::max<int>(p_sampleRow[x], p_backgroundRow[x] - step), p_backgroundRow[x] + step));
+		}
+	}
+
+	const BackgroundModelParameters parameters;
+	cv::Mat1b background;
+};
+
+// A pip centroid relative to the center of the die face, in units of half the face's side length.
+struct PipPosition
+{
+	float x;
+	float y;
+};
+
+// Distance of the outer pips from the center of the face along each axis, in units of half the face's side length.
+constexpr float PIP_OFFSET = 0.55f;
+
+// The canonical pip layouts of the faces for a die whose sides are axis-aligned. The pips lie on the diagonals or, for the six, on a grid whose 4-fold moment points along the diagonals too, which the rotation normalization relies on.
+template<uint Value> constexpr std::array<PipPosition, Value> getPipLayout();
+template<> constexpr std::array<PipPosition, 1> getPipLayout<1>() { return {{ { 0, 0 } }}; }
+template<> constexpr std::array<PipPosition, 2> getPipLayout<2>() { return {{ { -PIP_OFFSET, -PIP_OFFSET }, { PIP_OFFSET, PIP_OFFSET } }}; }
+template<> constexpr std::array<PipPosition, 3> getPipLayout<3>() { return {{ { -PIP_OFFSET, -PIP_OFFSET }, { 0, 0 }, { PIP_OFFSET, PIP_OFFSET } }}; }
+template<> constexpr std::array<PipPosition, 4> getPipLayout<4>() { return {{ { -PIP_OFFSET, -PIP_OFFSET }, { PIP_OFFSET, -PIP_OFFSET }, { -PIP_OFFSET, PIP_OFFSET }, { PIP_OFFSET, PIP_OFFSET } }}; }
+template<> constexpr std::array<PipPosition, 5> getPipLayout<5>() { return {{ { -PIP_OFFSET, -PIP_OFFSET }, { PIP_OFFSET, -PIP_OFFSET }, { 0, 0 }, { -PIP_OFFSET, PIP_OFFSET }, { PIP_OFFSET, PIP_OFFSET } }}; }
+template<> constexpr std::array<PipPosition, 6> getPipLayout<6>() { return {{ { -PIP_OFFSET, -PIP_OFFSET }, { -PIP_OFFSET, 0 }, { -PIP_OFFSET, PIP_OFFSET }, { PIP_OFFSET, -PIP_OFFSET }, { PIP_OFFSET, 0 }, { PIP_OFFSET, PIP_OFFSET } }}; }
+
+struct FaceClassification
+{
+	// 0 if no layout matches at all.
+	uint value;
+	// Symmetric similarity of the observed pips and the layout, between 0 and 1.
+	float confidence;
+};
+
+// Classifies a die face by matching its pip centroids against the canonical layouts. Works on a fixed-size array and allocates nothing, a classification takes well below a microsecond.
+class PipLayoutClassifier
+{
+public:
+	// Faces with more observed pips are rejected, they are most likely several touching dice.
+	enum { MAX_PIPS = 9 };
+
+	// Pip positions are in pixels; the center and half side length of the face come from the die's segmentation, so that a missing or extra pip does not shift the normalization.
+	static FaceClassification classify(std::array<PipPosition, MAX_PIPS>& pips, uint numPips, PipPosition faceCenter, float halfSideLength)
+	{
+		if (numPips == 0 || numPips > MAX_PIPS || halfSideLength <= 0)
+			return { 0, 0 };
+		normalize(pips, numPips, faceCenter, halfSideLength);
+
+		// The normalization leaves a quarter turn open, which matters for the two, three and six.
+		std::array<PipPosition, MAX_PIPS> turnedPips;
+		for (uint i = 0; i < numPips; ++i)
+			turnedPips[i] = { -pips[i].y, pips[i].x };
+
+		// Layouts that differ from the observation by more than two pips are not considered.
+		FaceClassification best = { 0, 0 };
+		considerLayout<1>(pips, turnedPips, numPips, best);
+		considerLayout<2>(pips, turnedPips, numPips, best);
+		considerLayout<3>(pips, turnedPips, numPips, best);
+		considerLayout<4>(pips, turnedPips, numPips, best);
+		considerLayout<5>(pips, turnedPips, numPips, best);
+		considerLayout<6>(pips, turnedPips, numPips, best);
+		return best;
+	}
+
+	// Classifies randomly rotated, scaled and jittered layouts of every face, all of which have to be recognized. Faces with one pip dropped (e.g. hidden by glare) or one spurious pip added (e.g. a reflection) have to be recognized as well or get a lower confidence than the intact face.
+	// The duration of the intact faces' classification is only reported, a timing is no pass condition for a check on a loaded machine.
+	static bool checkSelf(std::ostream& log)
+	{
+		const uint NUM_FACES_PER_VALUE = 100;
+		const PipPosition FACE_CENTER = { 968, 608 };
+		const std::array<PipPosition, 6> layouts[] = { padLayout<1>(), padLayout<2>(), padLayout<3>(), padLayout<4>(), padLayout<5>(), padLayout<6>() };
+		enum Perturbation { INTACT, DROPPED_PIP, SPURIOUS_PIP, NUM_PERTURBATIONS };
+		const char* const PERTURBATION_NAMES[] = { "intact", "one pip dropped", "one spurious pip" };
+		cv::RNG rng(6 * NUM_FACES_PER_VALUE);
+		std::vector<std::array<PipPosition, MAX_PIPS>> faces[NUM_PERTURBATIONS];
+		std::vector<uint> numPips[NUM_PERTURBATIONS];
+		// Dropping the center of a three or five and adding a center to a two or four turns a layout into another one.
+		std::vector<uint> expectedValues[NUM_PERTURBATIONS];
+		std::vector<float> halfSideLengths;
+		std::vector<uint> values;
+		for (uint value = 1; value <= 6; ++value)
+			for (uint i = 0; i < NUM_FACES_PER_VALUE; ++i)
+			{
+				// The jitter of up to a tenth of the side length is about what glare on a pip does to its centroid.
+				float angle = rng.uniform(0.f, static_cast<float>(2 * CV_PI)), halfSideLength = rng.uniform(15.f, 60.f);
+				auto transform = [&](float x, float y) { return PipPosition{ FACE_CENTER.x + halfSideLength * (std::cos(angle) * x - std::sin(angle) * y), FACE_CENTER.y + halfSideLength * (std::sin(angle) * x + std::cos(angle) * y) }; };
+				std::array<PipPosition, MAX_PIPS> face = {};
+				for (uint j = 0; j < value; ++j)
+					face[j] = transform(layouts[value - 1][j].x + rng.uniform(-0.1f, 0.1f), layouts[value - 1][j].y + rng.uniform(-0.1f, 0.1f));
+				faces[INTACT].push_back(face);
+				numPips[INTACT].push_back(value);
+				expectedValues[INTACT].push_back(value);
+
+				std::array<PipPosition, MAX_PIPS> droppedPipFace = face;
+				int droppedPipNo = rng.uniform(0, static_cast<int>(value));
+				droppedPipFace[droppedPipNo] = face[value - 1];
+				faces[DROPPED_PIP].push_back(droppedPipFace);
+				numPips[DROPPED_PIP].push_back(value - 1);
+				bool centerDropped = layouts[value - 1][droppedPipNo].x == 0 && layouts[value - 1][droppedPipNo].y == 0;
+				expectedValues[DROPPED_PIP].push_back(centerDropped && value > 1 ? value - 1 : value);
+
+				// Anywhere on the face, including on top of a layout pip.
+				std::array<PipPosition, MAX_PIPS> spuriousPipFace = face;
+				float spuriousX = rng.uniform(-0.9f, 0.9f), spuriousY = rng.uniform(-0.9f, 0.9f);
+				spuriousPipFace[value] = transform(spuriousX, spuriousY);
+				faces[SPURIOUS_PIP].push_back(spuriousPipFace);
+				numPips[SPURIOUS_PIP].push_back(value + 1);
+				bool centerAdded = spuriousX * spuriousX + spuriousY * spuriousY < getMatchRadius() * getMatchRadius();
+				expectedValues[SPURIOUS_PIP].push_back(centerAdded && (value == 2 || value == 4) ? value + 1 : value);
+
+				halfSideLengths.push_back(halfSideLength);
+				values.push_back(value);
+			}
+
+		std::vector<FaceClassification> classifications[NUM_PERTURBATIONS];
+		double durationMs = 0;
+		for (int perturbation = INTACT; perturbation < NUM_PERTURBATIONS; ++perturbation)
+		{
+			classifications[perturbation].resize(values.size());
+			int64 t0 = cv::getTickCount();
+			for (size_t i = 0; i < values.size(); ++i)
+				classifications[perturbation][i] = classify(faces[perturbation][i], numPips[perturbation][i], FACE_CENTER, halfSideLengths[i]);
+			if (perturbation == INTACT)
+				durationMs = 1000.0 * (cv::getTickCount() - t0) / cv::getTickFrequency();
+		}
+
+		bool passed = true;
+		for (int perturbation = INTACT; perturbation < NUM_PERTURBATIONS; ++perturbation)
+		{
+			size_t numCorrect = 0, numRejectable = 0;
+			float minimumConfidence = 1, maximumWrongConfidence = 0;
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				const FaceClassification& classification = classifications[perturbation][i];
+				if (classification.value == expectedValues[perturbation][i])
+				{
+					++numCorrect;
+					minimumConfidence = std::min(minimumConfidence, classification.confidence);
+				}
+				else
+				{
+					maximumWrongConfidence = std::max(maximumWrongConfidence, classification.confidence);
+					if (classification.confidence < classifications[INTACT][i].confidence)
+						++numRejectable;
+				}
+			}
+
+			bool perturbationPassed = numCorrect + (perturbation == INTACT ? 0 : numRejectable) == values.size();
+			log << (perturbationPassed ? "OK    " : "FAILED") << " pip layouts, " << PERTURBATION_NAMES[perturbation] << ": " << numCorrect << " of " << values.size() << " faces classified correctly (minimum confidence " << minimumConfidence << ")";
+			if (perturbation == INTACT)
+				log << " in " << durationMs << " ms" << std::endl;
+			else
+				log << ", " << numRejectable << " others with a lower confidence than intact (maximum " << maximumWrongConfidence << ")" << std::endl;
+			passed = passed && perturbationPassed;
+		}
+		return passed;
+	}
+
+private:
+	// Maximum distance, in units of half the side length, at which an observed pip still counts as a layout pip. Neighbouring layout pips are PIP_OFFSET apart.
+	static float getMatchRadius()
+	{
+		return 0.3f;
+	}
+
+	// Moves the face center to the origin, scales to units of half the side length and rotates the pips so that the face's sides are axis-aligned.
+	// The rotation is found from the 4-fold moment sum(z^4) of the pips as complex numbers z: it points along a diagonal for all canonical layouts and cannot tell quarter turns apart.
+	static void normalize(std::array<PipPosition, MAX_PIPS>& pips, uint numPips, PipPosition faceCenter, float halfSideLength)
+	{
+		float momentReal = 0, momentImaginary = 0;
+		for (uint i = 0; i < numPips; ++i)
+		{
+			float x = (pips[i].x - faceCenter.x) / halfSideLength, y = (pips[i].y - faceCenter.y) / halfSideLength;
+			pips[i] = { x, y };
+			float squareReal = x * x - y * y, squareImaginary = 2 * x * y;
+			momentReal += squareReal * squareReal - squareImaginary * squareImaginary;
+			momentImaginary += 2 * squareReal * squareImaginary;
+		}
+
+		// Without a moment (a single central pip) the rotation does not matter.
+		float angle = static_cast<float>(CV_PI / 4) - 0.25f * std::atan2(momentImaginary, momentReal);
+		float cosine = std::cos(angle), sine = std::sin(angle);
+		for (uint i = 0; i < numPips; ++i)
+			pips[i] = { cosine * pips[i].x - sine * pips[i].y, sine * pips[i].x + cosine * pips[i].y };
+	}
+
+	// Symmetric similarity: every layout pip is scored by its nearest observed pip and every observed pip by its nearest layout pip, so both missing and extra pips lower the score.
+	template<uint Value> static float scoreLayout(const std::array<PipPosition, MAX_PIPS>& pips, uint numPips)
+	{
+		constexpr std::array<PipPosition, Value> layout = getPipLayout<Value>();
+		const float squaredMatchRadius = getMatchRadius() * getMatchRadius();
+		std::array<float, MAX_PIPS> minimumSquaredDistances;
+		minimumSquaredDistances.fill(squaredMatchRadius);
+
+		float similaritySum = 0;
+		for (const PipPosition& layoutPip : layout)
+		{
+			float minimumSquaredDistance = squaredMatchRadius;
+			for (uint i = 0; i < numPips; ++i)
+			{
+				float squaredDistance = (pips[i].x - layoutPip.x) * (pips[i].x - layoutPip.x) + (pips[i].y - layoutPip.y) * (pips[i].y - layoutPip.y);
+				minimumSquaredDistance = std::min(minimumSquaredDistance, squaredDistance);
+				minimumSquaredDistances[i] = std::min(minimumSquaredDistances[i], squaredDistance);
+			}
+			similaritySum += 1 - minimumSquaredDistance / squaredMatchRadius;
+		}
+		for (uint i = 0; i < numPips; ++i)
+			similaritySum += 1 - minimumSquaredDistances[i] / squaredMatchRadius;
+		return similaritySum / (Value + numPips);
+	}
+
+	static constexpr bool isInvariantToQuarterTurns(uint value)
+	{
+		return value == 1 || value == 4 || value == 5;
+	}
+
+	template<uint Value> static std::array<PipPosition, 6> padLayout()
+	{
+		constexpr std::array<PipPosition, Value> layout = getPipLayout<Value>();
+		std::array<PipPosition, 6> paddedLayout = {};
+		std::copy(layout.begin(), layout.end(), paddedLayout.begin());
+		return paddedLayout;
+	}
+
+	template<uint Value> static void considerLayout(const std::array<PipPosition, MAX_PIPS>& pips, const std::array<PipPosition, MAX_PIPS>& turnedPips, uint numPips, FaceClassification& best)
+	{
+		if (numPips + 2 < Value || numPips > Value + 2)
+			return;
+		float confidence = scoreLayout<Value>(pips, numPips);
+		if (!isInvariantToQuarterTurns(Value))
+			confidence = std::max(confidence, scoreLayout<Value>(turnedPips, numPips));
+		if (confidence > best.confidence)
+			best = { Value, confidence };
+	}
+};
+
+// Parameters of the die classification, in pixels of the full-resolution frame unless noted otherwise.
+struct DieClassifierParameters
+{
+	// The pyramid level at which the dice are localized, the level's resolution is 1 / 2^level (2: 1/4 of the full resolution, 3: 1/8).
+	uint localizationLevel = 2;
+	// Margin added around the upscaled die regions, covering the blur of the pyramid and the rounding of the coarse boundaries.
+	int regionMargin = 8;
+	// Range of the visible area of a die including its pips.
+	int minimumDieArea = 1500;
+	int maximumDieArea = 40000;
+	// Minimum ratio of the shorter to the longer bounding box side of dice and pips.
+	double minimumAspectRatio = 0.5;
+	// Range of the area of a pip relative to the area of its die.
+	double minimumPipAreaRatio = 0.005;
+	double maximumPipAreaRatio = 0.1;
+	// Minimum fraction of its bounding box that a pip covers (pi / 4 for a circle).
+	double minimumPipFillRatio = 0.5;
+	// Diameter of the structuring element that closes the pips in the die mask, at least a pip diameter.
+	int pipClosingSize = 21;
+	// Minimum similarity of the pips to the best matching face layout (see PipLayoutClassifier).
+	float minimumLayoutConfidence = 0.5f;
+};
+
+// Grayscale versions of a frame, level i has 1 / 2^i of the full resolution. Built once per reference frame and shared by all classification stages.
+class FramePyramid
+{
+public:
+	FramePyramid(const cv::Mat3b& frame, uint numLevels)
+		: levels(std::max(numLevels, 1u))
+	{
+		cv::cvtColor(frame, levels[0], cv::COLOR_BGR2GRAY);
+		for (size_t i = 1; i < levels.size(); ++i)
+			cv::pyrDown(levels[i - 1], levels[i]);
+	}
+
+	const cv::Mat1b& getLevel(uint levelNo) const
+	{
+		return levels.at(levelNo);
+	}
+
+	uint getNumLevels() const
+	{
+		return static_cast<uint>(levels.size());
+	}
+
+	// Level i pixel (x, y) covers the full-resolution pixels [x * 2^i, (x + 1) * 2^i); pyrDown rounds odd sizes up, so the result is clipped to the frame.
+	cv::Rect mapToFullResolution(const cv::Rect& region, uint levelNo, int margin) const
+	{
+		int scale = 1 << levelNo;
+		cv::Rect upscaledRegion(region.x * scale - margin, region.y * scale - margin, region.width * scale + 2 * margin, region.height * scale + 2 * margin);
+		return upscaledRegion & cv::Rect(0, 0, levels[0].cols, levels[0].rows);
+	}
+
+private:
+	std::vector<cv::Mat1b> levels;
+};
+
+// A classified die and the confidence of its value (see FaceClassification).
+struct ClassifiedDie
+{
+	DetectedDie detectedDie;
+	float confidence;
+};
+
+// A die found at the localization level, in full-resolution coordinates.
+struct DieCandidate
+{
+	// The upscaled bounding box including the margin, all refinement happens within it.
+	cv::Rect region;
+	// The coarse centroid, it selects the candidate's component if neighbouring dice reach into the region.
+	cv::Point center;
+};
+
+// The candidates found in a frame and the gray level that separates the die faces from their pips, which the classification of the candidates needs.
+struct DieLocalization
+{
+	std::vector<DieCandidate> candidates;
+	double faceThreshold = 0;
+};
+
+// The die faces are brighter than the table: they are localized over the whole frame at a reduced resolution, then segmented again and their pips counted at full resolution only within the region of each candidate.
+class DieClassifier
+{
+public:
+	explicit DieClassifier(const DieClassifierParameters& parameters = DieClassifierParameters())
+		: parameters(parameters)
+	{
+	}
+
+	// With a foreground mask (see BackgroundModel, any resolution) the dice are only searched in the foreground. The localization can be passed out for reclassify.
+	std::vector<ClassifiedDie> classify(const cv::Mat3b& frame, DetectionResult& detectionResult, const cv::Mat1b& foregroundMask = cv::Mat1b(), DieLocalization* p_outLocalization = nullptr) const
+	{
+		std::unique_ptr<FramePyramid> p_pyramid;
+		{
+			ScopedStageTimer timer(detectionResult, "pyramid");
+			p_pyramid.reset(new FramePyramid(frame, parameters.localizationLevel + 1));
+		}
+
+		DieLocalization localization;
+		{
+			ScopedStageTimer timer(detectionResult, "dieLocalization");
+			localization.candidates = locateDieCandidates(*p_pyramid, foregroundMask, localization.faceThreshold);
+		}
+		std::vector<ClassifiedDie> classifiedDice = classifyCandidates(frame, p_pyramid->getLevel(0), localization, detectionResult);
+		if (p_outLocalization != nullptr)
+			*p_outLocalization = std::move(localization);
+		return classifiedDice;
+	}
+
+	// Classifies the dice at the candidates of an earlier frame in which they were at the same place, e.g. the first frame of a still period. Only the candidates' regions are converted to gray, so the cost depends on the number of dice, not on the frame size.
+	std::vector<ClassifiedDie> reclassify(const cv::Mat3b& frame, const DieLocalization& localization, DetectionResult& detectionResult) const
+	{
+		return classifyCandidates(frame, cv::Mat1b(), localization, detectionResult);
+	}
+
+private:
+	// Radius of the blur applied to the candidate regions before thresholding.
+	enum { FACE_BLUR_RADIUS = 2 };
+
+	// Without the gray frame, every candidate converts its own region.
+	std::vector<ClassifiedDie> classifyCandidates(const cv::Mat3b& frame, const cv::Mat1b& gray, const DieLocalization& localization, DetectionResult& detectionResult) const
+	{
+		const std::vector<DieCandidate>& candidates = localization.candidates;
+		addCounter(detectionResult, "dieCandidates", static_cast<int64_t>(candidates.size()));
+
+		// Every candidate only reads the frame and writes its own slot, so the candidates need no synchronization.
+		std::vector<ClassifiedDie> classifiedCandidates(candidates.size(), ClassifiedDie{ { cv::Point(), 0 }, 0 });
+		{
+			ScopedStageTimer timer(detectionResult, "pipCounting");
+			cv::parallel_for_(cv::Range(0, static_cast<int>(candidates.size())), [&](const cv::Range& range)
+			{
+				for (int i = range.start; i < range.end; ++i)
+					classifiedCandidates[i] = gray.empty() ? classifyCandidateRegion(frame, candidates[i], localization.faceThreshold) : classifyCandidate(gray, candidates[i], localization.faceThreshold);
+			});
+		}
+
+		// Candidates without pips, with too many (touching dice) or without a matching face layout are rejected.
+		std::vector<ClassifiedDie> classifiedDice;
+		for (const ClassifiedDie& classifiedCandidate : classifiedCandidates)
+			if (classifiedCandidate.detectedDie.value >= 1 && classifiedCandidate.detectedDie.value <= 6)
+				classifiedDice.push_back(classifiedCandidate);
+		addCounter(detectionResult, "rejectedDieCandidates", static_cast<int64_t>(candidates.size() - classifiedDice.size()));
+		return classifiedDice;
+	}
+
+	// The gray region includes the border that the blur of classifyCandidate reads, so the result is the same as with the gray frame.
+	ClassifiedDie classifyCandidateRegion(const cv::Mat3b& frame, const DieCandidate& candidate, double faceThreshold) const
+	{
+		cv::Rect grayRegion = cv::Rect(candidate.region.x - FACE_BLUR_RADIUS, candidate.region.y - FACE_BLUR_RADIUS, candidate.region.width + 2 * FACE_BLUR_RADIUS, candidate.region.height + 2 * FACE_BLUR_RADIUS) & cv::Rect(0, 0, frame.cols, frame.rows);
+		cv::Mat1b gray;
+		cv::cvtColor(frame(grayRegion), gray, cv::COLOR_BGR2GRAY);
+		DieCandidate grayCandidate = { cv::Rect(candidate.region.x - grayRegion.x, candidate.region.y - grayRegion.y, candidate.region.width, candidate.region.height), candidate.center - grayRegion.tl() };
+		ClassifiedDie classifiedDie = classifyCandidate(gray, grayCandidate, faceThreshold);
+		classifiedDie.detectedDie.somePositionWithin += grayRegion.tl();
+		return classifiedDie;
+	}
+
+	// With a foreground mask only the regions around its components are searched, at the level's resolution; without one the whole level is a single region.
+	std::vector<DieCandidate> locateDieCandidates(const FramePyramid& pyramid, const cv::Mat1b& foregroundMask, double& outFaceThreshold) const
+	{
+		// pyrDown has already low-pass filtered the level, it needs no further denoising.
+		uint levelNo = std::min(parameters.localizationLevel, pyramid.getNumLevels() - 1);
+		const cv::Mat1b& gray = pyramid.getLevel(levelNo);
+		int scale = 1 << levelNo;
+		int closingSize = std::max(parameters.pipClosingSize / scale, 1) | 1;
+
+		std::vector<cv::Rect> regions;
+		std::vector<cv::Mat1b> regionForegroundMasks;
+		if (foregroundMask.empty())
+		{
+			regions.push_back(cv::Rect(0, 0, gray.cols, gray.rows));
+			regionForegroundMasks.emplace_back();
+		}
+		else
+		{
+			// Dilating by a pixel of the mask includes the dark edges and shadows of the dice, whose difference to the table may be below the threshold.
+			cv::Mat1b dilatedForegroundMask;
+			cv::dilate(foregroundMask, dilatedForegroundMask, cv::Mat());
+
+			// The bounding boxes of the foreground's components get a margin that the closing below cannot reach across, overlapping boxes are merged so that no pixel is searched twice.
+			double levelPixelsPerMaskColumn = static_cast<double>(gray.cols) / foregroundMask.cols, levelPixelsPerMaskRow = static_cast<double>(gray.rows) / foregroundMask.rows;
+			int marginColumns = cvCeil((closingSize / 2 + 1) / levelPixelsPerMaskColumn), marginRows = cvCeil((closingSize / 2 + 1) / levelPixelsPerMaskRow);
+			cv::Mat1i labels;
+			cv::Mat stats, centroids;
+			int numLabels = cv::connectedComponentsWithStats(dilatedForegroundMask, labels, stats, centroids, 8, CV_32S);
+			std::vector<cv::Rect> maskRegions;
+			for (int label = 1; label < numLabels; ++label)
+			{
+				cv::Rect maskRegion(stats.at<int>(label, cv::CC_STAT_LEFT) - marginColumns, stats.at<int>(label, cv::CC_STAT_TOP) - marginRows, stats.at<int>(label, cv::CC_STAT_WIDTH) + 2 * marginColumns, stats.at<int>(label, cv::CC_STAT_HEIGHT) + 2 * marginRows);
+				maskRegion &= cv::Rect(0, 0, foregroundMask.cols, foregroundMask.rows);
+				for (size_t i = 0; i < maskRegions.size();)
+					if ((maskRegions[i] & maskRegion).area() > 0)
+					{
+						maskRegion |= maskRegions[i];
+						maskRegions[i] = maskRegions.back();
+						maskRegions.pop_back();
+						i = 0;
+					}
+					else
+						++i;
+				maskRegions.push_back(maskRegion);
+			}
+
+			for (const cv::Rect& maskRegion : maskRegions)
+			{
+				cv::Point topLeft(cvFloor(maskRegion.x * levelPixelsPerMaskColumn), cvFloor(maskRegion.y * levelPixelsPerMaskRow));
+				cv::Point bottomRight(std::min(cvCeil(maskRegion.br().x * levelPixelsPerMaskColumn), gray.cols), std::min(cvCeil(maskRegion.br().y * levelPixelsPerMaskRow), gray.rows));
+				regions.push_back(cv::Rect(topLeft, bottomRight));
+				regionForegroundMasks.emplace_back();
+				cv::resize(dilatedForegroundMask(maskRegion), regionForegroundMasks.back(), regions.back().size(), 0, 0, cv::INTER_NEAREST);
+			}
+			if (regions.empty())
+				return {};
+		}
+
+		// The threshold is computed from the foreground only, so it separates the faces from their pips and shadows rather than from the table's texture.
+		cv::Mat histogram;
+		const int channels[] = { 0 }, histogramSize[] = { 256 };
+		const float valueRange[] = { 0, 256 };
+		const float* p_valueRanges[] = { valueRange };
+		for (size_t i = 0; i < regions.size(); ++i)
+		{
+			cv::Mat regionGray = gray(regions[i]);
+			cv::calcHist(&regionGray, 1, channels, regionForegroundMasks[i], histogram, 1, histogramSize, p_valueRanges, true, i != 0);
+		}
+		outFaceThreshold = getOtsuThreshold(histogram);
+
+		// The area limits are loosened by the margin because the coarse boundaries are only accurate to a pixel of the level.
+		cv::Mat closingElement = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(closingSize, closingSize));
+		std::vector<DieCandidate> candidates;
+		for (size_t i = 0; i < regions.size(); ++i)
+		{
+			cv::Mat1b faceMask;
+			cv::threshold(gray(regions[i]), faceMask, outFaceThreshold, 255, cv::THRESH_BINARY);
+			if (!regionForegroundMasks[i].empty())
+				cv::bitwise_and(faceMask, regionForegroundMasks[i], faceMask);
+			cv::morphologyEx(faceMask, faceMask, cv::MORPH_CLOSE, closingElement);
+
+			cv::Mat1i labels;
+			cv::Mat stats, centroids;
+			int numLabels = cv::connectedComponentsWithStats(faceMask, labels, stats, centroids, 8, CV_32S);
+			for (int label = 1; label < numLabels; ++label)
+			{
+				cv::Rect boundingBox(regions[i].x + stats.at<int>(label, cv::CC_STAT_LEFT), regions[i].y + stats.at<int>(label, cv::CC_STAT_TOP), stats.at<int>(label, cv::CC_STAT_WIDTH), stats.at<int>(label, cv::CC_STAT_HEIGHT));
+				int area = stats.at<int>(label, cv::CC_STAT_AREA) * scale * scale;
+				if (area >= parameters.minimumDieArea / 2 && area <= 2 * parameters.maximumDieArea && getAspectRatio(boundingBox) >= 0.5 * parameters.minimumAspectRatio)
+				{
+					cv::Point center(cvFloor((regions[i].x + centroids.at<double>(label, 0) + 0.5) * scale), cvFloor((regions[i].y + centroids.at<double>(label, 1) + 0.5) * scale));
+					candidates.push_back({ pyramid.mapToFullResolution(boundingBox, levelNo, parameters.regionMargin), center });
+				}
+			}
+		}
+		return candidates;
+	}
+
+	// Otsu's threshold of a histogram of the 256 gray levels, computed like cv::threshold with THRESH_OTSU does from the histogram of an image: the levels above it form the brighter class.
+	static double getOtsuThreshold(const cv::Mat& histogram)
+	{
+		const float* p_counts = histogram.ptr<float>();
+		double numValues = 0, mean = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			numValues += p_counts[i];
+			mean += i * static_cast<double>(p_counts[i]);
+		}
+		if (numValues == 0)
+			return 0;
+		mean /= numValues;
+
+		const double epsilon = std::numeric_limits<float>::epsilon();
+		double lowerWeight = 0, lowerSum = 0, maximumVariance = 0, threshold = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			double probability = p_counts[i] / numValues;
+			lowerWeight += probability;
+			lowerSum += i * probability;
+			double upperWeight = 1 - lowerWeight;
+			if (std::min(lowerWeight, upperWeight) < epsilon || std::max(lowerWeight, upperWeight) > 1 - epsilon)
+				continue;
+			double meanDifference = lowerSum / lowerWeight - (mean - lowerSum) / upperWeight;
+			double variance = lowerWeight * upperWeight * meanDifference * meanDifference;
+			if (variance > maximumVariance)
+			{
+				maximumVariance = variance;
+				threshold = i;
+			}
+		}
+		return threshold;
+	}
+
+	ClassifiedDie classifyCandidate(const cv::Mat1b& gray, const DieCandidate& candidate, double faceThreshold) const
+	{
+		const ClassifiedDie rejected = { { cv::Point(), 0 }, 0 };
+
+		// Blurring the view of the region uses the frame's pixels around it, so the result is the same as blurring the whole frame.
+		cv::Mat1b faceMask;
+		cv::GaussianBlur(gray(candidate.region), faceMask, cv::Size(2 * FACE_BLUR_RADIUS + 1, 2 * FACE_BLUR_RADIUS + 1), 0);
+		cv::threshold(faceMask, faceMask, faceThreshold, 255, cv::THRESH_BINARY);
+		cv::Mat1b closedMask;
+		cv::morphologyEx(faceMask, closedMask, cv::MORPH_CLOSE, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(parameters.pipClosingSize, parameters.pipClosingSize)));
+
+		cv::Mat1i labels;
+		cv::Mat stats, centroids;
+		int numLabels = cv::connectedComponentsWithStats(closedMask, labels, stats, centroids, 8, CV_32S);
+		cv::Point localCenter = candidate.center - candidate.region.tl();
+		int dieLabel = cv::Rect(cv::Point(), candidate.region.size()).contains(localCenter) ? labels(localCenter) : 0;
+		if (dieLabel == 0)
+		{
+			// The coarse centroid misses the die if it has a concave outline at the coarse level, the largest component is taken instead.
+			for (int label = 1; label < numLabels; ++label)
+				if (dieLabel == 0 || stats.at<int>(label, cv::CC_STAT_AREA) > stats.at<int>(dieLabel, cv::CC_STAT_AREA))
+					dieLabel = label;
+			if (dieLabel == 0)
+				return rejected;
+		}
+
+		cv::Rect dieBox(stats.at<int>(dieLabel, cv::CC_STAT_LEFT), stats.at<int>(dieLabel, cv::CC_STAT_TOP), stats.at<int>(dieLabel, cv::CC_STAT_WIDTH), stats.at<int>(dieLabel, cv::CC_STAT_HEIGHT));
+		int dieArea = stats.at<int>(dieLabel, cv::CC_STAT_AREA);
+		if (dieArea < parameters.minimumDieArea || dieArea > parameters.maximumDieArea || getAspectRatio(dieBox) < parameters.minimumAspectRatio)
+			return rejected;
+
+		// The pips are the pixels of the die that are not bright face.
+		cv::Mat1b dieMask;
+		cv::compare(labels(dieBox), dieLabel, dieMask, cv::CMP_EQ);
+		cv::Mat1b pipMask;
+		cv::bitwise_and(dieMask, ~faceMask(dieBox), pipMask);
+
+		cv::Mat1i pipLabels;
+		cv::Mat pipStats, pipCentroids;
+		int numPipLabels = cv::connectedComponentsWithStats(pipMask, pipLabels, pipStats, pipCentroids, 8, CV_32S);
+		std::array<PipPosition, PipLayoutClassifier::MAX_PIPS> pips;
+		uint numPips = 0;
+		for (int label = 1; label < numPipLabels; ++label)
+		{
+			cv::Rect boundingBox(pipStats.at<int>(label, cv::CC_STAT_LEFT), pipStats.at<int>(label, cv::CC_STAT_TOP), pipStats.at<int>(label, cv::CC_STAT_WIDTH), pipStats.at<int>(label, cv::CC_STAT_HEIGHT));
+			int area = pipStats.at<int>(label, cv::CC_STAT_AREA);
+			double areaRatio = static_cast<double>(area) / dieArea;
+			double fillRatio = static_cast<double>(area) / boundingBox.area();
+			// Dark regions touching the die's bounding box are shadows or the die's edge, not pips.
+			bool touchesBorder = boundingBox.x == 0 || boundingBox.y == 0 || boundingBox.br().x == dieBox.width || boundingBox.br().y == dieBox.height;
+			if (areaRatio >= parameters.minimumPipAreaRatio && areaRatio <= parameters.maximumPipAreaRatio && fillRatio >= parameters.minimumPipFillRatio && getAspectRatio(boundingBox) >= parameters.minimumAspectRatio && !touchesBorder)
+			{
+				if (numPips == PipLayoutClassifier::MAX_PIPS)
+					return rejected;
+				pips[numPips++] = { static_cast<float>(pipCentroids.at<double>(label, 0)), static_cast<float>(pipCentroids.at<double>(label, 1)) };
+			}
+		}
+		if (numPips == 0)
+			return rejected;
+		cv::Point firstPipCenter(cvRound(pips[0].x), cvRound(pips[0].y));
+
+		// The value follows from the arrangement of the pips, not just their number, so that a glare spot or a missed pip rarely changes it.
+		PipPosition faceCenter = { static_cast<float>(centroids.at<double>(dieLabel, 0) - dieBox.x), static_cast<float>(centroids.at<double>(dieLabel, 1) - dieBox.y) };
+		FaceClassification faceClassification = PipLayoutClassifier::classify(pips, numPips, faceCenter, 0.5f * std::sqrt(static_cast<float>(dieArea)));
+		if (faceClassification.value == 0 || faceClassification.confidence < parameters.minimumLayoutConfidence)
+			return rejected;
+
+		// The centroid of a convex die lies within it; for odd shapes (e.g. partially occluded dice) a pip is used instead. Region and die box offsets are whole full-resolution pixels, so the position maps back exactly.
+		cv::Point dieCentroid(cvRound(faceCenter.x), cvRound(faceCenter.y));
+		cv::Point positionWithin = (dieMask(dieCentroid) != 0 ? dieCentroid : firstPipCenter) + dieBox.tl() + candidate.region.tl();
+		return { { positionWithin, faceClassification.value }, faceClassification.confidence };
+	}
+
+	static double getAspectRatio(const cv::Rect& boundingBox)
+	{
+		return static_cast<double>(std::min(boundingBox.width, boundingBox.height)) / std::max(boundingBox.width, boundingBox.height);
+	}
+
+	const DieClassifierParameters parameters;
+};
+
+// Configuration of the fusion of the classifications of several stable frames.
+struct TemporalFusionParameters
+{
+	// Number of most recent stable frames whose classifications vote on the value of a die (at most TemporalDieFusion::MAX_FRAMES).
+	uint numFrames = 5;
+
+	// Maximum distance in pixels between the positions of the same die in two stable frames.
+	float matchRadius = 20;
+};
+
+// Fuses the classifications of the stable frames of one still period: the dice are tracked by position, each track accumulates the confidences of its classifications per value over the last frames.
+// Only the tracks are kept, not the frames, and an additional frame costs time proportional to the number of dice. The fused dice are those seen in the anchor frame (the reference frame), at their position in it.
+class TemporalDieFusion
+{
+public:
+	enum { MAX_FRAMES = 16 };
+
+	explicit TemporalDieFusion(const TemporalFusionParameters& parameters = TemporalFusionParameters())
+		: numFrames(std::min<uint>(std::max(parameters.numFrames, 1u), MAX_FRAMES)), matchRadius(parameters.matchRadius)
+	{
+	}
+
+	void reset()
+	{
+		tracks.clear();
+		numObservations = 0;
+		anchored = false;
+	}
+
+	bool hasAnchor() const
+	{
+		return anchored;
+	}
+
+	uint getAnchorFrameNo() const
+	{
+		return anchorFrameNo;
+	}
+
+	uint getNumObservations() const
+	{
+		return numObservations;
+	}
+
+	// The frames have to be added in frame order; the anchor frame may change from frame to frame.
+	void addObservation(uint frameNo, const std::vector<ClassifiedDie>& dice, bool isAnchor)
+	{
+		// The votes of the frame leaving the window are withdrawn from every track. Tracks left without votes are dropped, unless they are needed for the anchor frame.
+		uint slotNo = numObservations % numFrames;
+		for (DieTrack& track : tracks)
+		{
+			track.voteSums[track.votes[slotNo].value] -= track.votes[slotNo].confidence;
+			track.votes[slotNo] = { 0, 0 };
+		}
+		if (isAnchor)
+		{
+			anchored = true;
+			anchorFrameNo = frameNo;
+			anchorObservationNo = numObservations;
+		}
+		tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [&](const DieTrack& track) { return !hasVotes(track) && !isInAnchorFrame(track); }), tracks.end());
+
+		// Hashing the tracks into cells of the match radius makes the search for the nearest track independent of the number of dice.
+		cellTracks.clear();
+		for (size_t i = 0; i < tracks.size(); ++i)
+			cellTracks.emplace(getCellKey(getCell(tracks[i].position)), i);
+
+		for (const ClassifiedDie& die : dice)
+		{
+			cv::Point2f position(die.detectedDie.somePositionWithin);
+			cv::Point cell = getCell(position);
+			DieTrack* p_nearestTrack = nullptr;
+			float nearestDistance = matchRadius;
+			for (int dy = -1; dy <= 1; ++dy)
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					auto cellRange = cellTracks.equal_range(getCellKey(cell + cv::Point(dx, dy)));
+					for (auto it = cellRange.first; it != cellRange.second; ++it)
+					{
+						DieTrack& track = tracks[it->second];
+						float distance = static_cast<float>(cv::norm(track.position - position));
+						if (track.lastObservationNo != numObservations && distance <= nearestDistance)
+						{
+							p_nearestTrack = &track;
+							nearestDistance = distance;
+						}
+					}
+				}
+
+			// New tracks are not hashed, a second die of this frame at the same place starts its own track.
+			if (p_nearestTrack == nullptr)
+			{
+				tracks.emplace_back();
+				p_nearestTrack = &tracks.back();
+			}
+			DieTrack& track = *p_nearestTrack;
+			track.position = position;
+			track.lastObservationNo = numObservations;
+			track.votes[slotNo] = { die.detectedDie.value, die.confidence };
+			track.voteSums[die.detectedDie.value] += die.confidence;
+			if (isAnchor)
+			{
+				track.anchorPosition = die.detectedDie.somePositionWithin;
+				track.anchorObservationNo = numObservations;
+			}
+		}
+		++numObservations;
+	}
+
+	// Every die of the anchor frame gets the value with the highest accumulated confidence in the window.
+	std::vector<DetectedDie> getFusedDice() const
+	{
+		std::vector<DetectedDie> fusedDice;
+		for (const DieTrack& track : tracks)
+			if (isInAnchorFrame(track))
+			{
+				uint value = static_cast<uint>(std::max_element(track.voteSums.begin() + 1, track.voteSums.end()) - track.voteSums.begin());
+				fusedDice.push_back({ track.anchorPosition, value });
+			}
+		return fusedDice;
+	}
+
+private:
+	struct Vote
+	{
+		// 0 if the die was not seen in the frame.
+		uint value;
+		float confidence;
+	};
+
+	struct DieTrack
+	{
+		cv::Point2f position;
+		cv::Point anchorPosition;
+		uint anchorObservationNo = std::numeric_limits<uint>::max();
+		uint lastObservationNo = std::numeric_limits<uint>::max();
+		// One vote per frame of the window, indexed by the observation number modulo the window size.
+		std::array<Vote, MAX_FRAMES> votes = {};
+		// Index 0 collects the empty votes and is never read.
+		std::array<float, 7> voteSums = {};
+	};
+
+	cv::Point getCell(const cv::Point2f& position) const
+	{
+		return cv::Point(cvFloor(position.x / matchRadius), cvFloor(position.y / matchRadius));
+	}
+
+	static int64_t getCellKey(const cv::Point& cell)
+	{
+		return (static_cast<int64_t>(cell.y) << 32) ^ static_cast<uint32_t>(cell.x);
+	}
+
+	bool hasVotes(const DieTrack& track) const
+	{
+		for (uint i = 0; i < numFrames; ++i)
+			if (track.votes[i].value != 0)
+				return true;
+		return false;
+	}
+
+	bool isInAnchorFrame(const DieTrack& track) const
+	{
+		return anchored && track.anchorObservationNo == anchorObservationNo;
+	}
+
+	const uint numFrames;
+	const float matchRadius;
+	std::vector<DieTrack> tracks;
+	std::unordered_multimap<int64_t, size_t> cellTracks;
+	uint numObservations = 0;
+	bool anchored = false;
+	uint anchorFrameNo = 0;
+	uint anchorObservationNo = 0;
+};
+
+// The classification of a stable frame, which runs after the frame's commit so that it does not hold up the in-order stage (see FramePipeline::FinishFunction).
+struct StableFrameClassification
+{
+	uint frameNo = 0;
+	bool isFirstOfPeriod = false;
+	std::vector<ClassifiedDie> classifiedDice;
+	// Stage times and counters of the classification, added to the detection result once all frames are done since the classifications run concurrently.
+	DetectionResult statistics;
+};
+
+// The stable frames of one still period. Nothing moves while the video is still, so the dice are only localized in the first stable frame, within its foreground, and the later frames are classified at the first frame's candidates.
+struct StillPeriod
+{
+	cv::Mat1b firstForegroundMask;
+	std::promise<DieLocalization> localizationPromise;
+	// Set by the first frame's classification, the later frames wait for it.
+	std::shared_future<DieLocalization> localization = localizationPromise.get_future().share();
+	// In frame order.
+	std::vector<std::shared_ptr<StableFrameClassification>> classifications;
+};
+
+void addStatistics(DetectionResult& detectionResult, const DetectionResult& statistics)
+{
+	for (const auto& stageTime : statistics.stageTimesMs)
+		addStageTime(detectionResult, stageTime.first, stageTime.second);
+	for (const auto& counter : statistics.counters)
+		addCounter(detectionResult, counter.first, counter.second);
+}
+
 DetectionResult detectDice(cv::VideoCapture& videoCapture)
 {
-	// TODO: Detect the dice in the video provided! Return the result like shown here (also see struct definitions above):
 	DetectionResult detectionResult;
-	detectionResult.referenceFrameNo = 42;
-	detectionResult.detectedDice.push_back({ cv::Point(100, 200), 3 });
-	detectionResult.detectedDice.push_back({ cv::Point(400, 500), 6 });
+
+	// One sample per second by default, like the notebook.
+	FrameScanParameters scanParameters;
+	if (scanParameters.sampleInterval == 0)
+	{
+		double fps = videoCapture.get(cv::CAP_PROP_FPS);
+		scanParameters.sampleInterval = fps >= 1 ? static_cast<uint>(cvRound(fps)) : 1;
+	}
+
+	// The classifications of the stable frames are fused per still period, the result is that of the period with the reference frame.
+	StableFrameSelector frameSelector(scanParameters);
+	DieClassifier classifier;
+	BackgroundModel backgroundModel;
+	std::vector<std::shared_ptr<StillPeriod>> stillPeriods;
+	// The stable frames whose classification has not started yet, by frame number.
+	std::unordered_map<uint, std::pair<std::shared_ptr<StillPeriod>, std::shared_ptr<StableFrameClassification>>> pendingClassifications;
+	std::mutex pendingClassificationsMutex;
+	auto classifyStableFrame = [&](const PipelineFrame& frame)
+	{
+		std::shared_ptr<StillPeriod> p_period;
+		std::shared_ptr<StableFrameClassification> p_classification;
+		{
+			std::lock_guard<std::mutex> lock(pendingClassificationsMutex);
+			auto it = pendingClassifications.find(frame.frameNo);
+			if (it == pendingClassifications.end())
+				return;
+			p_period = it->second.first;
+			p_classification = it->second.second;
+			pendingClassifications.erase(it);
+		}
+
+		if (p_classification->isFirstOfPeriod)
+		{
+			ScopedStageTimer timer(p_classification->statistics, "classification");
+			try
+			{
+				DieLocalization localization;
+				p_classification->classifiedDice = classifier.classify(frame.image, p_classification->statistics, p_period->firstForegroundMask, &localization);
+				p_period->firstForegroundMask.release();
+				p_period->localizationPromise.set_value(std::move(localization));
+			}
+			catch (...)
+			{
+				p_period->localizationPromise.set_exception(std::current_exception());
+				throw;
+			}
+		}
+		else
+		{
+			const DieLocalization& localization = p_period->localization.get();
+			ScopedStageTimer timer(p_classification->statistics, "classification");
+			p_classification->classifiedDice = classifier.reclassify(frame.image, localization, p_classification->statistics);
+		}
+	};
+
+	{
+		// Includes the classification of the stable frames, which runs after their commit, concurrently with the following frames.
+		ScopedStageTimer timer(detectionResult, "frameSelection");
+		FramePipeline pipeline;
+		cv::Mat1b foregroundMask;
+		uint numDecodedFrames = pipeline.run(videoCapture,
+			[&](uint frameNo) { return frameNo % scanParameters.sampleInterval == 0; },
+			[&](PipelineFrame& frame) { frameSelector.computeSample(frame.image, frame.analysis); },
+			[&](const PipelineFrame& frame)
+			{
+				frameSelector.addSample(frame.frameNo, frame.analysis, frame.image);
+				bool foregroundMaskUsable;
+				{
+					ScopedStageTimer timer(detectionResult, "backgroundModel");
+					foregroundMaskUsable = backgroundModel.apply(frame.analysis, foregroundMask);
+				}
+				if (frameSelector.getNumConsecutiveStableSamples() != 0)
+				{
+					addCounter(detectionResult, "stableFramesWithoutForeground", foregroundMaskUsable ? 0 : 1);
+					std::shared_ptr<StableFrameClassification> p_classification = std::make_shared<StableFrameClassification>();
+					p_classification->frameNo = frame.frameNo;
+					p_classification->isFirstOfPeriod = frameSelector.getNumConsecutiveStableSamples() == 1 || stillPeriods.empty();
+					if (p_classification->isFirstOfPeriod)
+					{
+						stillPeriods.push_back(std::make_shared<StillPeriod>());
+						if (foregroundMaskUsable)
+							foregroundMask.copyTo(stillPeriods.back()->firstForegroundMask);
+					}
+					stillPeriods.back()->classifications.push_back(p_classification);
+					std::lock_guard<std::mutex> lock(pendingClassificationsMutex);
+					pendingClassifications.emplace(frame.frameNo, std::make_pair(stillPeriods.back(), p_classification));
+				}
+				return !frameSelector.hasSettled();
+			},
+			classifyStableFrame);
+		addCounter(detectionResult, "decodedFrames", numDecodedFrames);
+		addCounter(detectionResult, "frameBufferAllocations", pipeline.getFramePoolStatistics().numAllocations);
+
+		// The frame count of the container may be inexact, it is only used for reporting.
+		int numVideoFrames = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_COUNT));
+		addCounter(detectionResult, "framesNotDecoded", frameSelector.hasSettled() ? std::max(0, numVideoFrames - static_cast<int>(numDecodedFrames)) : 0);
+	}
+	addCounter(detectionResult, "retrievedFrames", frameSelector.getNumSamples());
+	if (!frameSelector.hasFrame())
+		throw std::runtime_error("The video contains no frames!");
+
+	detectionResult.referenceFrameNo = frameSelector.getBestFrameNo();
+	for (const std::shared_ptr<StillPeriod>& p_period : stillPeriods)
+		for (const std::shared_ptr<StableFrameClassification>& p_classification : p_period->classifications)
+			addStatistics(detectionResult, p_classification->statistics);
+	for (const std::shared_ptr<StillPeriod>& p_period : stillPeriods)
+	{
+		const std::vector<std::shared_ptr<StableFrameClassification>>& classifications = p_period->classifications;
+		if (std::none_of(classifications.begin(), classifications.end(), [&](const std::shared_ptr<StableFrameClassification>& p_classification) { return p_classification->frameNo == detectionResult.referenceFrameNo; }))
+			continue;
+
+		TemporalDieFusion fusion;
+		{
+			ScopedStageTimer timer(detectionResult, "temporalFusion");
+			for (const std::shared_ptr<StableFrameClassification>& p_classification : classifications)
+				fusion.addObservation(p_classification->frameNo, p_classification->classifiedDice, p_classification->frameNo == detectionResult.referenceFrameNo);
+			detectionResult.detectedDice = fusion.getFusedDice();
+		}
+		addCounter(detectionResult, "fusedFrames", fusion.getNumObservations());
+		return detectionResult;
+	}
+
+	// The reference frame is not a stable frame if the video never became still after some motion, it is classified on its own then.
+	{
+		ScopedStageTimer timer(detectionResult, "classification");
+		for (const ClassifiedDie& classifiedDie : classifier.classify(frameSelector.getBestFrame(), detectionResult))
+			detectionResult.detectedDice.push_back(classifiedDie.detectedDie);
+	}
+	addCounter(detectionResult, "fusedFrames", 1);
 	return detectionResult;
 }
 
+// A synthetic throw at the evaluation's frame size: one die of every value slides in from the left over a noisy table and comes to rest after the given number of frames, which is at least 49 for the dice to start outside the frame. Reports one frame per second, so the frame scan samples every frame.
+class SyntheticThrowSource : public cv::VideoCapture
+{
+public:
+	SyntheticThrowSource(uint numFramesBeforeRest, uint numFramesAtRest)
+		: numFramesBeforeRest(numFramesBeforeRest), numFrames(numFramesBeforeRest + numFramesAtRest), table(FRAME_HEIGHT, FRAME_WIDTH)
+	{
+		cv::RNG rng(FRAME_WIDTH * FRAME_HEIGHT);
+		rng.fill(table, cv::RNG::UNIFORM, cv::Scalar::all(40), cv::Scalar::all(80));
+	}
+
+	bool isOpened() const override
+	{
+		return true;
+	}
+
+	bool grab() override
+	{
+		if (nextFrameNo >= numFrames)
+			return false;
+		grabbedFrameNo = nextFrameNo++;
+		return true;
+	}
+
+	// Renders into the existing memory of the image if it has the right size and type.
+	bool retrieve(cv::OutputArray image, int = 0) override
+	{
+		if (grabbedFrameNo >= numFrames)
+		{
+			image.release();
+			return false;
+		}
+
+		table.copyTo(image);
+		cv::Mat frame = image.getMat();
+		int offset = DIE_SPEED * static_cast<int>(numFramesBeforeRest - std::min(grabbedFrameNo, numFramesBeforeRest));
+		drawDie<1>(frame, cv::Point(400 - offset, 600));
+		drawDie<2>(frame, cv::Point(600 - offset, 600));
+		drawDie<3>(frame, cv::Point(800 - offset, 600));
+		drawDie<4>(frame, cv::Point(1000 - offset, 600));
+		drawDie<5>(frame, cv::Point(1200 - offset, 600));
+		drawDie<6>(frame, cv::Point(1400 - offset, 600));
+		return true;
+	}
+
+	bool read(cv::OutputArray image) override
+	{
+		if (!grab())
+		{
+			image.release();
+			return false;
+		}
+		return retrieve(image);
+	}
+
+	double get(int propId) const override
+	{
+		switch (propId)
+		{
+		case cv::CAP_PROP_FPS:
+			return 1;
+		case cv::CAP_PROP_POS_FRAMES:
+			return nextFrameNo;
+		case cv::CAP_PROP_FRAME_COUNT:
+			return numFrames;
+		case cv::CAP_PROP_FRAME_WIDTH:
+			return FRAME_WIDTH;
+		case cv::CAP_PROP_FRAME_HEIGHT:
+			return FRAME_HEIGHT;
+		default:
+			return 0;
+		}
+	}
+
+private:
+	enum { FRAME_WIDTH = 1936, FRAME_HEIGHT = 1216, DIE_HALF_SIDE = 50, PIP_RADIUS = 8, DIE_SPEED = 30 };
+
+	template<uint Value> static void drawDie(cv::Mat& frame, const cv::Point& center)
+	{
+		cv::rectangle(frame, cv::Rect(center.x - DIE_HALF_SIDE, center.y - DIE_HALF_SIDE, 2 * DIE_HALF_SIDE, 2 * DIE_HALF_SIDE), cv::Scalar::all(230), cv::FILLED);
+		for (const PipPosition& pip : getPipLayout<Value>())
+			cv::circle(frame, cv::Point(center.x + cvRound(pip.x * DIE_HALF_SIDE), center.y + cvRound(pip.y * DIE_HALF_SIDE)), PIP_RADIUS, cv::Scalar::all(20), cv::FILLED);
+	}
+
+	const uint numFramesBeforeRest;
+	const uint numFrames;
+	cv::Mat3b table;
+	uint nextFrameNo = 0;
+	uint grabbedFrameNo = std::numeric_limits<uint>::max();
+};
+
+// Checks with a counting default allocator that detectDice makes no frame-buffer (cv::Mat) allocations per frame: two synthetic throws that differ only in the number of frames before the dice come to rest (empty table first, then the same approach) have to cost the same number of allocations.
+// What remains is per detection, not per frame, and is reported: the first use of the scan's and the background model's buffers, and the classification of the few stable frames. A classification allocates its intermediate images (pyramid, region masks, labels and statistics of the connected components) as it goes; the first stable frame of a still period is localized over its foreground, the others only convert and label the dice's regions, so these are not worth pooling.
+// Only cv::Mat data goes through the allocator. Other heap allocations are not counted, e.g. the pipeline's jobs (std::function), the still periods and their promises, and the nodes of the fusion's hash map.
+bool checkSteadyStateAllocations(std::ostream& log)
+{
+	const uint NUM_FRAMES_AT_REST = 10;
+	const uint NUM_FRAMES_BEFORE_REST[] = { 60, 90 };
+
+	// Initializes what OpenCV and the detector set up once per process.
+	SyntheticThrowSource warmUpSource(NUM_FRAMES_BEFORE_REST[0], NUM_FRAMES_AT_REST);
+	detectDice(warmUpSource);
+
+	size_t numAllocations[2];
+	DetectionResult detectionResults[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		SyntheticThrowSource source(NUM_FRAMES_BEFORE_REST[i], NUM_FRAMES_AT_REST);
+		CountingMatAllocator countingAllocator;
+		cv::MatAllocator* p_previousAllocator = cv::Mat::getDefaultAllocator();
+		cv::Mat::setDefaultAllocator(&countingAllocator);
+		try
+		{
+			detectionResults[i] = detectDice(source);
+		}
+		catch (...)
+		{
+			cv::Mat::setDefaultAllocator(p_previousAllocator);
+			throw;
+		}
+		cv::Mat::setDefaultAllocator(p_previousAllocator);
+		numAllocations[i] = countingAllocator.getNumAllocations();
+	}
+
+	auto getCounter = [](const DetectionResult& detectionResult, const std::string& counterName)
+	{
+		for (const auto& counter : detectionResult.counters)
+			if (counter.first == counterName)
+				return counter.second;
+		return static_cast<int64_t>(0);
+	};
+	int64_t numClassifiedFrames = getCounter(detectionResults[1], "fusedFrames"), numDieCandidates = getCounter(detectionResults[1], "dieCandidates");
+
+	// Without candidates the classification would not have been measured.
+	bool passed = numAllocations[1] == numAllocations[0] && numDieCandidates > 0;
+	log << (passed ? "OK    " : "FAILED") <<  " steady state of the frame buffers: " << numAllocations[0] << " cv::Mat allocation(s) with " << NUM_FRAMES_BEFORE_REST[0] << " frames before the dice rest, " << numAllocations[1] << " with " << NUM_FRAMES_BEFORE_REST[1]
+		<< "; per detection, including " << numClassifiedFrames << " classified stable frame(s) with " << numDieCandidates << " die candidate(s) and " << detectionResults[1].detectedDice.size() << " of 6 dice detected" << std::endl;
+	return passed;
+}
+
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // ! You should not change anything BELOW this point. !
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
-int main(int numArgs, const char** pp_args)
+#ifdef DICE_DETECTION_PLUGIN
+// Built as a shared library (define DICE_DETECTION_PLUGIN), the evaluation calls detectDice in-process instead of starting a new process for every video.
+#if _WIN32
+#define DICE_DETECTION_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define DICE_DETECTION_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+extern "C" DICE_DETECTION_PLUGIN_EXPORT uint diceDetectionPluginVersion()
 {
-	if (numArgs != 3)
+	return 2;
+}
+
+// Returns 0 on success. The detected dice, stage times and counters are passed back one by one through the callbacks, so no C++ types cross the library boundary except cv::VideoCapture.
+extern "C" DICE_DETECTION_PLUGIN_EXPORT int diceDetectionPluginDetect(cv::VideoCapture* p_videoCapture, uint* p_outReferenceFrameNo, void (*p_addDie)(void*, int, int, uint), void (*p_addStageTime)(void*, const char*, double), void (*p_addCounter)(void*, const char*, int64_t), void* p_context)
+{
+	try
 	{
-		std::cerr << "Invalid command line arguments: Specify the video filename and the detection result filename!" << std::endl;
-		return 1;
+		int64 t0 = cv::getTickCount();
+		DetectionResult detectionResult = detectDice(*p_videoCapture);
+		addStageTime(detectionResult, "detectDice", 1000.0 * (cv::getTickCount() - t0) / cv::getTickFrequency());
+		*p_outReferenceFrameNo = detectionResult.referenceFrameNo;
+		for (const DetectedDie& detectedDie : detectionResult.detectedDice)
+			p_addDie(p_context, detectedDie.somePositionWithin.x, detectedDie.somePositionWithin.y, detectedDie.value);
+		for (const auto& stageTime : detectionResult.stageTimesMs)
+			p_addStageTime(p_context, stageTime.first.c_str(), stageTime.second);
+		for (const auto& counter : detectionResult.counters)
+			p_addCounter(p_context, counter.first.c_str(), counter.second);
+		return 0;
 	}
-
-	const std::string videoFilename = pp_args[1];
-	const std::string detectionResultFilename = pp_args[2];
-
-	cv::VideoCapture videoCapture(videoFilename);
+	catch (const std::exception& e)
+	{
+		std::cerr << "Dice detection failed: " << e.what() << std::endl;
+		return -1;
+	}
+}
+#else
+// Detects the dice in one video and writes the detection result file. Returns the exit status of a single-shot run.
+int detectAndWriteResult(const std::string& videoFilename, const std::string& detectionResultFilename, const std::string& sharedFramesSegmentName)
+{
+	// Uses the frames already decoded by the evaluation if available (see "SharedFrameSource.hpp"), otherwise opens the video file.
+	SharedFrameSource videoCapture(videoFilename, sharedFramesSegmentName);
 	if (!videoCapture.isOpened())
 	{
 		std::cerr << "Failed to open video file \"" << videoFilename << "\"!" << std::endl;
 		return 1;
 	}
 
+	// The time outside of detectDice (process start, opening the video) is the difference to the wall time measured by the evaluation.
+	int64 t0 = cv::getTickCount();
 	DetectionResult detectionResult = detectDice(videoCapture);
+	addStageTime(detectionResult, "detectDice", 1000.0 * (cv::getTickCount() - t0) / cv::getTickFrequency());
 
 	std::ofstream fileStream(detectionResultFilename);
 	fileStream << detectionResult.referenceFrameNo << std::endl;
 	fileStream << detectionResult.detectedDice.size() << std::endl;
 	for (const DetectedDie& detectedDie : detectionResult.detectedDice)
 		fileStream << detectedDie.somePositionWithin.x << ' ' << detectedDie.somePositionWithin.y << ' ' << detectedDie.value << std::endl;
+	for (const auto& stageTime : detectionResult.stageTimesMs)
+		fileStream << "stage " << stageTime.first << ' ' << stageTime.second << std::endl;
+	for (const auto& counter : detectionResult.counters)
+		fileStream << "counter " << counter.first << ' ' << counter.second << std::endl;
 	if (!fileStream)
 	{
 		std::cerr << "Failed to open/create/write detection result file \"" << detectionResultFilename << "\"!" << std::endl;
@@ -71,4 +1999,60 @@ int main(int numArgs, const char** pp_args)
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+
+// Worker mode of the evaluation ("--persistent-competitors", see PersistentCompetitorProcess in "Evaluation.cpp"): after "ready", each request line "<video filename>\t<detection result filename>\t<shared frames segment name>" on stdin is answered with "done <status>" on stdout, until stdin is closed.
+int runWorker()
+{
+	std::cout << "ready" << std::endl;
+	std::string request;
+	while (std::getline(std::cin, request))
+	{
+		std::istringstream requestStream(request);
+		std::string videoFilename, detectionResultFilename, sharedFramesSegmentName;
+		std::getline(requestStream, videoFilename, '\t');
+		std::getline(requestStream, detectionResultFilename, '\t');
+		std::getline(requestStream, sharedFramesSegmentName);
+
+		// A failed video must not end the worker, it only fails its request.
+		int status = 1;
+		try
+		{
+			if (!videoFilename.empty() && !detectionResultFilename.empty())
+				status = detectAndWriteResult(videoFilename, detectionResultFilename, sharedFramesSegmentName);
+			else
+				std::cerr << "Invalid worker request \"" << request << "\"!" << std::endl;
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Dice detection failed: " << e.what() << std::endl;
+		}
+		std::cout << "done " << status << std::endl;
+	}
+	return 0;
+}
+
+int main(int numArgs, const char** pp_args)
+{
+	// Checks the optimized kernels of the detector against the OpenCV functions they replace, and that the frame scan runs without frame-buffer allocations.
+	if (numArgs == 2 && std::string(pp_args[1]) == "--self-check")
+	{
+		bool passed = FusedPreprocessor::checkAgainstReference(std::cout);
+		passed = PipLayoutClassifier::checkSelf(std::cout) && passed;
+		passed = checkSteadyStateAllocations(std::cout) && passed;
+		return passed ? 0 : 1;
+	}
+
+	if (numArgs == 2 && std::string(pp_args[1]) == "--worker")
+		return runWorker();
+
+	if (numArgs != 3)
+	{
+		std::cerr << "Invalid command line arguments: Specify the video filename and the detection result filename (or --self-check, or --worker for the evaluation's worker mode)!" << std::endl;
+		return 1;
+	}
+
+	const char* p_sharedFramesSegmentName = std::getenv("DICE_SHARED_FRAMES");
+	return detectAndWriteResult(pp_args[1], pp_args[2], p_sharedFramesSegmentName ? p_sharedFramesSegmentName : "");
+}
+#endif
\ No newline at end of file
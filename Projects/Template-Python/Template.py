@@ -50,28 +50,50 @@ def detect_dice(video_capture):
 # ! You should not change anything BELOW this point. !
 # !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
-if len(sys.argv) != 3:
-    sys.stderr.write("Invalid command line arguments: Specify the video filename and the detection result filename!\n")
-    sys.exit(1)
+def detect_and_write_result(video_filename, detection_result_filename):
+    video_capture = cv2.VideoCapture(video_filename)
+    if not video_capture.isOpened():
+        sys.stderr.write("Failed to open video file\"" + video_filename + "\"!\n")
+        return False
 
-video_filename = sys.argv[1]
-detection_result_filename = sys.argv[2]
+    reference_frame_no, detected_dice = detect_dice(video_capture)
 
-video_capture = cv2.VideoCapture(video_filename)
-if not video_capture.isOpened():
-    sys.stderr.write("Failed to open video file\"" + video_filename + "\"!\n")
-    sys.exit(1)
+    try:
+        with open(detection_result_filename, "w") as file:
+            file.write("%d\n" % reference_frame_no)
+            file.write("%d\n" % len(detected_dice))
+            for detected_die in detected_dice:
+                file.write("%d %d %d\n" % detected_die)
+    except IOError:
+        sys.stderr.write("Failed to open/create/write detection result file \"" + detection_result_filename + "\"!\n")
+        return False
 
-reference_frame_no, detected_dice = detect_dice(video_capture)
+    return True
 
-try:
-    with open(detection_result_filename, "w") as file:
-        file.write("%d\n" % reference_frame_no)
-        file.write("%d\n" % len(detected_dice))
-        for detected_die in detected_dice:
-            file.write("%d %d %d\n" % detected_die)
-except IOError:
-    sys.stderr.write("Failed to open/create/write detection result file \"" + detection_result_filename + "\"!\n")
+# Worker mode of the evaluation ("--persistent-competitors"): the interpreter and the modules are loaded once, then each request line "<video filename>\t<detection result filename>\t<shared frames segment name>" on stdin is answered with "done <status>" on stdout, until stdin is closed.
+if len(sys.argv) == 2 and sys.argv[1] == "--worker":
+    sys.stdout.write("ready\n")
+    sys.stdout.flush()
+    while True:
+        request = sys.stdin.readline()
+        if not request:
+            break
+        fields = request.rstrip("\r\n").split("\t")
+        # A failed video must not end the worker, it only fails its request.
+        try:
+            succeeded = len(fields) >= 2 and detect_and_write_result(fields[0], fields[1])
+        except Exception as exception:
+            sys.stderr.write("Dice detection failed: %s\n" % exception)
+            succeeded = False
+        sys.stdout.write("done %d\n" % (0 if succeeded else 1))
+        sys.stdout.flush()
+    sys.exit(0)
+
+if len(sys.argv) != 3:
+    sys.stderr.write("Invalid command line arguments: Specify the video filename and the detection result filename (or --worker for the evaluation's worker mode)!\n")
+    sys.exit(1)
+
+if not detect_and_write_result(sys.argv[1], sys.argv[2]):
     sys.exit(1)
 
 # When running from IDLE, any OpenCV windows will remain open.
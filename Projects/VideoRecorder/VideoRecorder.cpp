@@ -1,6 +1,7 @@
 #include <ctime>
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "../Common/FramePool.hpp"
 #include <mvIMPACT_CPP/mvIMPACT_acquire_GenICam.h>
 
 // Source: https://stackoverflow.com/questions/16605967/set-precision-of-stdto-string-when-converting-floating-point-values
@@ -11,8 +12,11 @@ template <typename T> std::string toString(T value, int precision = 6)
 	return out.str();
 }
 
-int main()
+int main(int numArgs, const char** pp_args)
 {
+	// "--verbose" prints the frame pool statistics at the end.
+	bool verbose = numArgs == 2 && std::string(pp_args[1]) == "--verbose";
+
 	const std::string WINDOW_NAME = "VideoRecorder";
 	const int KEY_PAGE_UP = 2162688;
 	const int KEY_PAGE_DOWN = 2228224;
@@ -41,9 +45,14 @@ int main()
 	for (int i = 0; i < p_systemSettings->requestCount.read(); ++i)
 		p_functionInterface->imageRequestSingle();
 	
+	// The camera frame and the GUI image are refilled in place every frame; the pool keeps their buffers (and shows in its statistics, with "--verbose", that nothing is allocated per frame).
+	FramePool framePool("VideoRecorder");
 	cv::Mat3b frame;
 	cv::Mat3b gui;
 	cv::Mat3b frameMarkedForLabeling;
+	framePool.attach(frame);
+	framePool.attach(gui);
+	framePool.attach(frameMarkedForLabeling);
 	cv::VideoWriter videoWriter;
 	std::string videoFilename;
 	int numFramesRecorded = 0;
@@ -174,5 +183,7 @@ int main()
 			break;
 	}
 
+	if (verbose)
+		framePool.printStatistics(std::cout);
 	return 0;
 }
\ No newline at end of file